@@ -0,0 +1,89 @@
+// ============== BATTERY TESTER STATUS ==============
+// Parsing of the tester's GET /status reply: an HTTP/1.x 200 response whose
+// body is a flat JSON object with at least "v", "i" and "p". Kept free of
+// Arduino so canned replies can be fed to it in the native tests.
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define BT_RESP_MAX           768
+#define BT_V_MAX              100.0f  // plausibility limits for a tester reading
+#define BT_I_MAX              50.0f
+#define BT_P_MAX              5000.0f
+
+struct BtReading {
+  float v;
+  float i;
+  float p;
+};
+
+// Find "key":<number> in a flat JSON object. The number must end at a
+// delimiter, so a value cut off mid-digits is not taken as a shorter one.
+inline bool jsonNumber(const char* json, const char* key, float* out) {
+  char pat[24];
+  snprintf(pat, sizeof(pat), "\"%s\":", key);
+  const char* p = strstr(json, pat);
+  if (!p) return false;
+  p += strlen(pat);
+  char* end;
+  float v = strtof(p, &end);
+  if (end == p) return false;
+  while (*end == ' ' || *end == '\t' || *end == '\r' || *end == '\n') end++;
+  if (*end != ',' && *end != '}') return false;
+  *out = v;
+  return true;
+}
+
+// strtof happily returns nan/inf, which would end up as invalid JSON in /status
+inline bool btPlausible(float v, float i, float p) {
+  return isfinite(v) && isfinite(i) && isfinite(p) &&
+         v >= 0 && v <= BT_V_MAX && fabsf(i) <= BT_I_MAX && fabsf(p) <= BT_P_MAX;
+}
+
+// resp holds len bytes of the reply and has room for a terminator. Returns
+// nullptr with *out filled, or why the reply was rejected.
+inline const char* btParseStatus(char* resp, size_t len, BtReading* out) {
+  // A reply that filled the buffer was cut off somewhere
+  if (len >= BT_RESP_MAX - 1) return "truncated";
+  resp[len] = 0;
+  const char* body = strstr(resp, "\r\n\r\n");
+  if (len < 12 || strncmp(resp, "HTTP/1.", 7) != 0 || strncmp(resp + 8, " 200", 4) != 0 || !body) {
+    return "status";
+  }
+  BtReading r;
+  if (!jsonNumber(body, "v", &r.v) || !jsonNumber(body, "i", &r.i) || !jsonNumber(body, "p", &r.p) ||
+      !btPlausible(r.v, r.i, r.p)) {
+    return "parse";
+  }
+  *out = r;
+  return nullptr;
+}
+
+// /btconfig host: a name or an IPv4/IPv6 literal. It is echoed into JSON and
+// the Host: header, so quotes, spaces and CR/LF must never get through.
+inline bool btValidHost(const char* host, size_t cap) {
+  size_t n = strlen(host);
+  if (n == 0 || n >= cap) return false;
+  for (size_t k = 0; k < n; k++) {
+    char c = host[k];
+    if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+          c == '.' || c == '-' || c == ':')) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Decimal 1..65535 and nothing else
+inline bool btParsePort(const char* s, uint16_t* out) {
+  if (*s < '0' || *s > '9') return false;
+  char* end;
+  long v = strtol(s, &end, 10);
+  if (*end != 0 || v < 1 || v > 65535) return false;
+  *out = (uint16_t)v;
+  return true;
+}
@@ -12,7 +12,16 @@
 #include <SPIFFS.h>
 #include <FS.h>
 #include <ArduinoOTA.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <esp_ota_ops.h>
 #include "Audio.h"          // ESP32-audioI2S (Schreibfaul1)
+#include "mem_arena.h"
+#include "sample_bus.h"
+#include "session_maps.h"
+#include "scheduler.h"
+#include "ota_stream.h"
+#include "bt_status.h"
 
 // ============== PIN DEFINITIONS (ESP32 LyraT) ==============
 #define ONE_WIRE_BUS    13   // DS18B20 data pin (both sensors on same bus)
@@ -45,24 +54,131 @@ WebServer server(80);
 #define MLX_PIXELS (MLX_COLS * MLX_ROWS)
 
 float mlxFrame[MLX_PIXELS];
-float dsTemp1 = -127.0;
-float dsTemp2 = -127.0;
 DeviceAddress dsAddr1, dsAddr2;
 int dsCount = 0;
 bool mlxConnected = false;
 float mlxMax = 0, mlxMin = 999, mlxAvg = 0;
-unsigned long lastDsRequest = 0;
+int64_t dsRequestUs = 0;
 bool dsConversionRequested = false;
-unsigned long lastMlxRead = 0;
+int dsReadJob = -1;
+#define MLX_READ_MS     500
+#define DS_REQUEST_MS   2000
+#define DS_CONVERT_MS   800     // 12-bit conversion is 750 ms
 
 // ============== SPIFFS LOGGING ==============
 bool spiffsReady = false;
 bool loggingEnabled = false;
 unsigned long logStartTime = 0;
-unsigned long lastLogWrite = 0;
+int logJob = -1;
 #define LOG_INTERVAL_MS 2000
 #define LOG_FILE "/templog.csv"
 #define MAX_LOG_SIZE 500000
+#define LOG_FLUSH_RECORDS 10      // staged records per SPIFFS write (20 s)
+uint16_t logStaged = 0;
+
+// ============== MEMORY ARENAS ==============
+// Arena and pool logic lives in mem_arena.h; this is the board's layout.
+// mlxFrame stays a static internal array: I2C writes it every frame.
+// btArena is MEM_INTERNAL: the poll copies each reply out of lwIP into it
+// and parses it in place on the loop task every second.
+#define RESP_BLOCK_SIZE  16384
+#define RESP_BLOCKS      2
+#define MEM_SAMPLE_MS    5000
+
+MemArena logArena  = { "log",  MEM_PSRAM, 2048 };
+MemArena mapArena  = { "maps", MEM_PSRAM, MAP_ARENA_BYTES(MLX_PIXELS) };
+MemArena otaArena  = { "ota",  MEM_PSRAM, 49152 };
+MemArena btArena   = { "bt",   MEM_INTERNAL, BT_RESP_MAX };
+MemPool  respPool  = { "resp", MEM_PSRAM, RESP_BLOCK_SIZE, RESP_BLOCKS };
+
+MemArena* memArenas[] = { &logArena, &mapArena, &otaArena, &btArena };
+MemPool*  memPools[]  = { &respPool };
+
+size_t memLargestInternalMin = SIZE_MAX;  // soak: must stay flat over days
+size_t memFreeInternalMin = SIZE_MAX;
+
+void* memRawAlloc(size_t size, MemPlace place) {
+  if (place == MEM_PSRAM) {
+    return psramFound() ? heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT) : nullptr;
+  }
+  return heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+void setupMemory() {
+  Serial.printf("[MEM] PSRAM %s, internal free %u, largest block %u\n",
+    psramFound() ? "found" : "NOT FOUND",
+    heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+    heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL));
+  for (MemArena* a : memArenas) {
+    memArenaInit(*a, memRawAlloc);
+    Serial.printf("[MEM] Arena %s: %u bytes in %s%s\n", a->name, a->cap,
+      memPlaceName(a->got), a->base ? "" : " FAILED");
+  }
+  for (MemPool* p : memPools) {
+    memPoolInit(*p, memRawAlloc);
+    Serial.printf("[MEM] Pool %s: %u x %u bytes in %s%s\n", p->name, p->blockCount,
+      p->blockSize, memPlaceName(p->got), p->base ? "" : " FAILED");
+  }
+}
+
+void memSample() {
+  size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+  size_t freeInt = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  if (largest < memLargestInternalMin) memLargestInternalMin = largest;
+  if (freeInt < memFreeInternalMin) memFreeInternalMin = freeInt;
+}
+
+// HTTP response built in a pool block instead of a growing String
+struct RespBuf {
+  char* buf;
+  size_t len;
+  size_t cap;
+  bool overflow;
+
+  RespBuf() : buf((char*)memPoolGet(respPool)), len(0),
+    cap(buf ? respPool.blockSize : 0), overflow(buf == nullptr) {}
+  ~RespBuf() {
+    if (!memPoolPut(respPool, buf)) Serial.println("[MEM] RespBuf returned a block twice");
+  }
+  RespBuf(const RespBuf&) = delete;
+  RespBuf& operator=(const RespBuf&) = delete;
+
+  void append(const char* s, size_t n) {
+    if (overflow || len + n >= cap) { overflow = true; return; }
+    memcpy(buf + len, s, n);
+    len += n;
+  }
+
+  void appendf(const char* fmt, ...) {
+    if (overflow) return;
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf + len, cap - len, fmt, args);
+    va_end(args);
+    if (n < 0 || len + n >= cap) { overflow = true; return; }
+    len += n;
+  }
+
+  RespBuf& operator+=(const char* s) { append(s, strlen(s)); return *this; }
+
+  void send(int code, const char* type) {
+    if (overflow) {
+      server.send(503, "text/plain", buf ? "Response too large" : "No response buffer free");
+      return;
+    }
+    server.send_P(code, type, buf, len);
+  }
+};
+
+// ============== SAMPLE BUS ==============
+// Ring and reader logic lives in sample_bus.h
+SampleBus sampleBus;
+BusReader logReader = { "log" };
+BusReader webReader = { "web" };
+
+// ============== SCHEDULER ==============
+// Heap and run loop live in scheduler.h; all jobs share this instance
+Scheduler sched = { esp_timer_get_time };
 
 // ============== AUDIO ==============
 Audio audio;
@@ -194,18 +310,30 @@ void setupMLX() {
   }
 }
 
+// ============== SESSION MAPS ==============
+// Accumulator logic lives in session_maps.h
+SessionMaps maps;
+
+void setupMaps() {
+  if (!mapInit(maps, mapArena, MLX_PIXELS, millis())) {
+    Serial.println("[MAP] Arena too small, session maps disabled");
+    return;
+  }
+  Serial.printf("[MAP] Session maps ready, threshold %.1f C\n", maps.thrCc / 100.0);
+}
+
 // ============== MLX READ ==============
 void mlxRead() {
   if (!mlxConnected) return;
-  if (millis() - lastMlxRead < 500) return;
-  lastMlxRead = millis();
 
   if (mlx.getFrame(mlxFrame) != 0) return;
+  int64_t frameUs = esp_timer_get_time();
 
   mlxMax = -40;
   mlxMin = 300;
   float sum = 0;
   int validCount = 0;
+  if (maps.ready) mapBeginFrame(maps, millis());
 
   for (int i = 0; i < MLX_PIXELS; i++) {
     float t = mlxFrame[i];
@@ -214,33 +342,149 @@ void mlxRead() {
       if (t < mlxMin) mlxMin = t;
       sum += t;
       validCount++;
+      if (maps.ready) mapAccumulate(maps, i, t);
     }
   }
-  if (validCount > 0) mlxAvg = sum / validCount;
+  if (validCount == 0) return;
+  mlxAvg = sum / validCount;
+
+  uint8_t q = validCount < MLX_PIXELS ? SQ_PARTIAL : SQ_OK;
+  busPublish(sampleBus, SRC_MLX_MAX, mlxMax, q, frameUs);
+  busPublish(sampleBus, SRC_MLX_MIN, mlxMin, q, frameUs);
+  busPublish(sampleBus, SRC_MLX_AVG, mlxAvg, q, frameUs);
 }
 
 // ============== DS18B20 NON-BLOCKING READ ==============
 void dsRequestTemps() {
   dsSensors.requestTemperatures();
   dsConversionRequested = true;
-  lastDsRequest = millis();
+  dsRequestUs = esp_timer_get_time();
+  if (dsReadJob >= 0) schedArm(sched, dsReadJob, schedNowMs(sched) + DS_CONVERT_MS);
+}
+
+// Samples are stamped with the start of the conversion
+void dsPublish(uint8_t src, float t) {
+  bool valid = t > -50 && t < 125 && t != 85.0;
+  busPublish(sampleBus, src, t, valid ? SQ_OK : SQ_REJECTED, dsRequestUs);
 }
 
 void dsReadResults() {
   if (!dsConversionRequested) return;
-  if (millis() - lastDsRequest < 800) return;
   dsConversionRequested = false;
 
-  if (dsCount >= 1) {
-    float t = dsSensors.getTempC(dsAddr1);
-    if (t > -50 && t < 125 && t != 85.0) dsTemp1 = t;
+  if (dsCount >= 1) dsPublish(SRC_DS1, dsSensors.getTempC(dsAddr1));
+  if (dsCount >= 2) dsPublish(SRC_DS2, dsSensors.getTempC(dsAddr2));
+}
+
+// ============== BATTERY TESTER POLLER ==============
+// The hub polls the tester's /status itself and serves the last reading to
+// every dashboard, so the tester sees one client no matter how many are open.
+// Connect is bounded by BT_CONNECT_TIMEOUT_MS (LAN IP, no DNS); the response
+// is drained without waiting across loop() passes; bt_status.h parses it.
+#define BT_DEFAULT_HOST       "192.168.1.40"
+#define BT_DEFAULT_PORT       80
+#define BT_POLL_MS            2000
+#define BT_CONNECT_TIMEOUT_MS 300
+#define BT_TIMEOUT_MS         1500
+#define BT_BACKOFF_MAX_MS     30000
+#define BT_STALE_MS           10000
+#define BT_STEP_MS            10      // response drain interval while in flight
+
+enum BtState { BT_IDLE, BT_WAIT_RESPONSE };
+
+WiFiClient btClient;
+char btHost[40] = BT_DEFAULT_HOST;
+uint16_t btPort = BT_DEFAULT_PORT;
+BtState btState = BT_IDLE;
+char* btResp = nullptr;          // BT_RESP_MAX bytes from btArena
+size_t btRespLen = 0;
+unsigned long btNextPoll = 0;
+unsigned long btReqStart = 0;
+int64_t btReqUs = 0;
+unsigned long btBackoff = BT_POLL_MS;
+uint32_t btFailCount = 0;
+int btJob = -1;
+
+void btFail(const char* why) {
+  btState = BT_IDLE;
+  btFailCount++;
+  btBackoff = min((unsigned long)BT_BACKOFF_MAX_MS, btBackoff * 2);
+  btNextPoll = millis() + btBackoff;
+  Serial.printf("[BT] Poll %s failed, retry in %lu ms\n", why, btBackoff);
+}
+
+void btParseResponse() {
+  btClient.stop();
+  BtReading r;
+  const char* why = btParseStatus(btResp, btRespLen, &r);
+  if (why) {
+    btFail(why);
+    return;
   }
-  if (dsCount >= 2) {
-    float t = dsSensors.getTempC(dsAddr2);
-    if (t > -50 && t < 125 && t != 85.0) dsTemp2 = t;
+  busPublish(sampleBus, SRC_BT_V, r.v, SQ_OK, btReqUs);
+  busPublish(sampleBus, SRC_BT_I, r.i, SQ_OK, btReqUs);
+  busPublish(sampleBus, SRC_BT_P, r.p, SQ_OK, btReqUs);
+  btState = BT_IDLE;
+  btBackoff = BT_POLL_MS;
+  btNextPoll = btReqStart + BT_POLL_MS;
+}
+
+void btStep() {
+  if (WiFi.status() != WL_CONNECTED) {
+    btNextPoll = millis() + BT_POLL_MS;
+    return;
+  }
+
+  if (btState == BT_IDLE) {
+    if ((long)(millis() - btNextPoll) < 0) return;
+    btReqStart = millis();
+    btReqUs = esp_timer_get_time();
+    btRespLen = 0;
+    if (!btClient.connect(btHost, btPort, BT_CONNECT_TIMEOUT_MS)) {
+      btFail("connect");
+      return;
+    }
+    // HTTP/1.0 keeps the tester from answering chunked
+    btClient.printf("GET /status HTTP/1.0\r\nHost: %s\r\nConnection: close\r\n\r\n", btHost);
+    btState = BT_WAIT_RESPONSE;
+    return;
+  }
+
+  // BT_WAIT_RESPONSE: take what has arrived, never block for more
+  int n = btClient.available();
+  if (n > 0) {
+    size_t room = BT_RESP_MAX - 1 - btRespLen;
+    if ((size_t)n > room) n = room;
+    // read() is -1 when available() hit a socket error and dropped the buffer
+    int got = btClient.read((uint8_t*)btResp + btRespLen, n);
+    if (got <= 0) {
+      btClient.stop();
+      btFail("read");
+      return;
+    }
+    btRespLen += got;
+  }
+  if (btRespLen >= BT_RESP_MAX - 1 || (!btClient.connected() && !btClient.available())) {
+    btParseResponse();
+  } else if (millis() - btReqStart > BT_TIMEOUT_MS) {
+    btClient.stop();
+    btFail("timeout");
   }
 }
 
+// Scheduler job: re-arms itself for the next drain or the next poll
+void btPoll() {
+  if (!btResp) return;   // no reply buffer, polling stays off
+  btStep();
+  if (btJob < 0) return;
+  schedArm(sched, btJob, btState == BT_WAIT_RESPONSE ? schedNowMs(sched) + BT_STEP_MS : btNextPoll);
+}
+
+void setupBt() {
+  btResp = (char*)memAlloc(btArena, BT_RESP_MAX, 1);
+  if (!btResp) Serial.println("[BT] Arena too small, tester polling disabled");
+}
+
 // ============== SPIFFS INIT ==============
 void initSPIFFS() {
   if (SPIFFS.begin(true)) {
@@ -257,20 +501,20 @@ void startTempLog() {
   if (!spiffsReady) return;
   File f = SPIFFS.open(LOG_FILE, FILE_WRITE);
   if (f) {
-    f.println("timestamp,t1,t2,mlx_max,mlx_avg");
+    f.println("timestamp,t1,t2,mlx_max,mlx_avg,v,i,p,ds_age_ms,mlx_age_ms,bt_age_ms,drops");
     f.close();
     loggingEnabled = true;
     logStartTime = millis();
-    lastLogWrite = 0;
+    if (logJob >= 0) schedArm(sched, logJob, schedNowMs(sched));
+    memReset(logArena);
+    logStaged = 0;
     Serial.println("[LOG] Temp logging started");
   }
 }
 
-void appendTempLog() {
-  if (!spiffsReady || !loggingEnabled) return;
-  if (millis() - lastLogWrite < LOG_INTERVAL_MS) return;
-  lastLogWrite = millis();
-
+// Write the staged records to SPIFFS in one append
+void flushTempLog() {
+  if (!spiffsReady || logArena.used == 0) return;
   File f = SPIFFS.open(LOG_FILE, FILE_APPEND);
   if (!f) return;
 
@@ -278,15 +522,74 @@ void appendTempLog() {
     f.close();
     loggingEnabled = false;
     Serial.println("[LOG] Max size reached, logging stopped");
-    return;
+  } else {
+    f.write(logArena.base, logArena.used);
+    f.close();
   }
+  memReset(logArena);
+  logStaged = 0;
+}
+
+#define LOG_NO_STALE (ULONG_MAX - 1)
+
+// Appends at line[n]. snprintf reports what it wanted to write, so n is
+// clamped to the buffer: an over-long field truncates the record instead
+// of pushing n (and the next write) past the end of line.
+void logPrintf(char* line, size_t cap, size_t& n, const char* fmt, ...) {
+  if (n + 1 >= cap) return;
+  va_list args;
+  va_start(args, fmt);
+  int w = vsnprintf(line + n, cap - n, fmt, args);
+  va_end(args);
+  if (w > 0) n = min(n + (size_t)w, cap - 1);
+}
+
+// One CSV field from the logger's view of the bus; empty when the source
+// was never seen or its last sample is older than maxAgeMs
+void logField(char* line, size_t cap, size_t& n, uint8_t src, const char* fmt, unsigned long maxAgeMs) {
+  if (busAgeMs(logReader, src, esp_timer_get_time()) > maxAgeMs) logPrintf(line, cap, n, ",");
+  else logPrintf(line, cap, n, fmt, logReader.latest[src].value);
+}
+
+void logAge(char* line, size_t cap, size_t& n, uint8_t src) {
+  unsigned long age = busAgeMs(logReader, src, esp_timer_get_time());
+  if (age == ULONG_MAX) logPrintf(line, cap, n, ",");
+  else logPrintf(line, cap, n, ",%lu", age);
+}
+
+void appendTempLog() {
+  if (!spiffsReady || !loggingEnabled) return;
 
+  busDrain(sampleBus, logReader);
   unsigned long elapsed = (millis() - logStartTime) / 1000;
-  char line[80];
-  snprintf(line, sizeof(line), "%lu,%.2f,%.2f,%.1f,%.1f",
-    elapsed, dsTemp1, dsTemp2, mlxMax, mlxAvg);
-  f.println(line);
-  f.close();
+  char line[160];
+  size_t cap = sizeof(line) - 2;    // room for the CRLF
+  size_t n = 0;
+  logPrintf(line, cap, n, "%lu", elapsed);
+  logField(line, cap, n, SRC_DS1, ",%.2f", LOG_NO_STALE);
+  logField(line, cap, n, SRC_DS2, ",%.2f", LOG_NO_STALE);
+  logField(line, cap, n, SRC_MLX_MAX, ",%.1f", LOG_NO_STALE);
+  logField(line, cap, n, SRC_MLX_AVG, ",%.1f", LOG_NO_STALE);
+  // Battery columns stay empty while the tester is unreachable
+  logField(line, cap, n, SRC_BT_V, ",%.3f", BT_STALE_MS);
+  logField(line, cap, n, SRC_BT_I, ",%.2f", BT_STALE_MS);
+  logField(line, cap, n, SRC_BT_P, ",%.1f", BT_STALE_MS);
+  logAge(line, cap, n, SRC_DS1);
+  logAge(line, cap, n, SRC_MLX_MAX);
+  logAge(line, cap, n, SRC_BT_V);
+  logPrintf(line, cap, n, ",%u", logReader.dropped);
+
+  // Records are staged back to back in logArena
+  strlcat(line, "\r\n", sizeof(line));
+  size_t len = strlen(line);
+  char* dst = (char*)memAlloc(logArena, len, 1);
+  if (!dst) {
+    flushTempLog();
+    dst = (char*)memAlloc(logArena, len, 1);
+    if (!dst) return;
+  }
+  memcpy(dst, line, len);
+  if (++logStaged >= LOG_FLUSH_RECORDS) flushTempLog();
 }
 
 // ============== WEB: LOG ENDPOINTS ==============
@@ -296,12 +599,14 @@ void handleStartLog() {
 }
 
 void handleStopLog() {
+  flushTempLog();
   loggingEnabled = false;
   Serial.println("[LOG] Logging stopped");
   server.send(200, "application/json", "{\"ok\":true,\"msg\":\"Logging stopped\"}");
 }
 
 void handleDownload() {
+  flushTempLog();
   if (!spiffsReady || !SPIFFS.exists(LOG_FILE)) {
     server.send(404, "text/plain", "No log file");
     return;
@@ -319,6 +624,8 @@ void handleDeleteLog() {
   if (loggingEnabled) {
     loggingEnabled = false;
   }
+  memReset(logArena);
+  logStaged = 0;
   if (spiffsReady && SPIFFS.exists(LOG_FILE)) {
     SPIFFS.remove(LOG_FILE);
   }
@@ -331,13 +638,43 @@ void handleLogInfo() {
     File f = SPIFFS.open(LOG_FILE, FILE_READ);
     if (f) { fileSize = f.size(); f.close(); }
   }
-  String j = "{\"logging\":" + String(loggingEnabled ? "true" : "false");
-  j += ",\"size\":" + String(fileSize);
-  j += ",\"totalSpace\":" + String(spiffsReady ? SPIFFS.totalBytes() : 0);
-  j += ",\"usedSpace\":" + String(spiffsReady ? SPIFFS.usedBytes() : 0);
-  j += ",\"freeSpace\":" + String(spiffsReady ? (SPIFFS.totalBytes() - SPIFFS.usedBytes()) : 0);
+  size_t total = spiffsReady ? SPIFFS.totalBytes() : 0;
+  size_t used = spiffsReady ? SPIFFS.usedBytes() : 0;
+  RespBuf j;
+  j.appendf("{\"logging\":%s", loggingEnabled ? "true" : "false");
+  j.appendf(",\"size\":%u", fileSize + logArena.used);
+  j.appendf(",\"staged\":%u", logArena.used);
+  j.appendf(",\"totalSpace\":%u", total);
+  j.appendf(",\"usedSpace\":%u", used);
+  j.appendf(",\"freeSpace\":%u", total - used);
   j += "}";
-  server.send(200, "application/json", j);
+  j.send(200, "application/json");
+}
+
+// ============== WEB: MEMORY STATS ==============
+void handleMem() {
+  memSample();
+  RespBuf j;
+  j.appendf("{\"psram\":%s", psramFound() ? "true" : "false");
+  j.appendf(",\"internalFree\":%u", heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+  j.appendf(",\"internalFreeMin\":%u", memFreeInternalMin);
+  j.appendf(",\"internalLargest\":%u", heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL));
+  j.appendf(",\"internalLargestMin\":%u", memLargestInternalMin);
+  j.appendf(",\"psramFree\":%u", heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+  j += ",\"arenas\":[";
+  for (size_t i = 0; i < sizeof(memArenas) / sizeof(memArenas[0]); i++) {
+    MemArena& a = *memArenas[i];
+    j.appendf("%s{\"name\":\"%s\",\"place\":\"%s\",\"cap\":%u,\"used\":%u,\"high\":%u,\"fails\":%u}",
+      i ? "," : "", a.name, memPlaceName(a.got), a.cap, a.used, a.highWater, a.fails);
+  }
+  j += "],\"pools\":[";
+  for (size_t i = 0; i < sizeof(memPools) / sizeof(memPools[0]); i++) {
+    MemPool& p = *memPools[i];
+    j.appendf("%s{\"name\":\"%s\",\"place\":\"%s\",\"block\":%u,\"blocks\":%u,\"inUse\":%u,\"high\":%u,\"fails\":%u,\"badPuts\":%u}",
+      i ? "," : "", p.name, memPlaceName(p.got), p.blockSize, p.blockCount, p.inUse, p.highWater, p.fails, p.badPuts);
+  }
+  j += "]}";
+  j.send(200, "application/json");
 }
 
 // ============== WEB: SPEECH ENDPOINT ==============
@@ -358,7 +695,8 @@ void handleSay() {
 
 // ============== WEB: MAIN PAGE ==============
 void handleRoot() {
-  String h = "<!DOCTYPE html><html><head><meta charset='UTF-8'>";
+  RespBuf h;
+  h += "<!DOCTYPE html><html><head><meta charset='UTF-8'>";
   h += "<meta name='viewport' content='width=device-width,initial-scale=1'>";
   h += "<title>LyraT Sensor Hub v9.0</title>";
   h += "<script src='https://cdn.jsdelivr.net/npm/chart.js'></script>";
@@ -495,17 +833,15 @@ void handleRoot() {
   h += "btns.forEach(function(b){if(b.textContent!='Clear')b.className='tbtn'});";
   h += "event.target.className='tbtn active';rebuildChart();}";
 
-  // --- Battery tester fetch ---
-  h += "function fetchBT(){";
-  h += "fetch('http://192.168.1.40/status').then(function(r){return r.json()}).then(function(d){";
-  h += "btV=d.v;btI=d.i;btP=d.p;";
-  h += "if(btV!=null)$('sv5').innerHTML=btV.toFixed(3)+'<span class=\"seg-unit\">V</span>';";
-  h += "if(btI!=null)$('sv6').innerHTML=Math.abs(btI).toFixed(2)+'<span class=\"seg-unit\">A</span>';";
-  h += "if(btP!=null)$('sv7').innerHTML=Math.abs(btP).toFixed(1)+'<span class=\"seg-unit\">W</span>';";
-  h += "$('btst').innerText='Online';$('btst').style.color='#0f0';";
-  h += "}).catch(function(){";
-  h += "$('btst').innerText='Offline';$('btst').style.color='#f44';";
-  h += "});}";
+  // --- Battery tester (polled by the hub, delivered in /status) ---
+  h += "function showBT(b){";
+  h += "if(b&&b.ok){btV=b.v;btI=b.i;btP=b.p;";
+  h += "$('sv5').innerHTML=btV.toFixed(3)+'<span class=\"seg-unit\">V</span>';";
+  h += "$('sv6').innerHTML=Math.abs(btI).toFixed(2)+'<span class=\"seg-unit\">A</span>';";
+  h += "$('sv7').innerHTML=Math.abs(btP).toFixed(1)+'<span class=\"seg-unit\">W</span>';";
+  h += "$('btst').innerText='Online ('+(b.age/1000).toFixed(1)+'s)';$('btst').style.color='#0f0';";
+  h += "}else{btV=null;btI=null;btP=null;";
+  h += "$('btst').innerText='Offline';$('btst').style.color='#f44';}}";
 
   // --- Main update ---
   h += "function upd(){fetch('/status').then(function(r){return r.json()}).then(function(d){";
@@ -517,6 +853,7 @@ void handleRoot() {
   h += "$('cnt').innerText=d.dsCount;";
   h += "$('mlxst').innerText=d.mlxOk?'Connected':'NOT FOUND';";
   h += "$('mlxst').style.color=d.mlxOk?'#0f0':'#f44';";
+  h += "showBT(d.bt);";
   // Add to history
   h += "var pt=[Date.now(),t1,t2,d.mlxMax,d.mlxAvg,btV,btI,btP];";
   h += "hist.push(pt);";
@@ -544,25 +881,45 @@ void handleRoot() {
 
   // --- Init ---
   h += "rebuildChart();";
-  h += "setInterval(upd,2000);setInterval(fetchBT,2000);setInterval(updLog,5000);";
-  h += "upd();fetchBT();updLog();";
+  h += "setInterval(upd,2000);setInterval(updLog,5000);";
+  h += "upd();updLog();";
   h += "</script></body></html>";
 
-  server.send(200, "text/html", h);
+  h.send(200, "text/html");
 }
 
 // ============== WEB: STATUS JSON ==============
 void handleStatus() {
-  String j = "{";
-  j += "\"t1\":" + String(dsTemp1, 2);
-  j += ",\"t2\":" + String(dsTemp2, 2);
-  j += ",\"dsCount\":" + String(dsCount);
-  j += ",\"mlxOk\":" + String(mlxConnected ? "true" : "false");
-  j += ",\"mlxMax\":" + String(mlxMax, 1);
-  j += ",\"mlxMin\":" + String(mlxMin, 1);
-  j += ",\"mlxAvg\":" + String(mlxAvg, 1);
+  RespBuf j;
+  busDrain(sampleBus, webReader);
+  const BusReader& r = webReader;
+  j.appendf("{\"t1\":%.2f", busValue(r, SRC_DS1, -127.0));
+  j.appendf(",\"t2\":%.2f", busValue(r, SRC_DS2, -127.0));
+  j.appendf(",\"dsCount\":%d", dsCount);
+  j.appendf(",\"mlxOk\":%s", mlxConnected ? "true" : "false");
+  j.appendf(",\"mlxMax\":%.1f", busValue(r, SRC_MLX_MAX, 0));
+  j.appendf(",\"mlxMin\":%.1f", busValue(r, SRC_MLX_MIN, 0));
+  j.appendf(",\"mlxAvg\":%.1f", busValue(r, SRC_MLX_AVG, 0));
+  unsigned long btAge = busAgeMs(r, SRC_BT_V, esp_timer_get_time());
+  j.appendf(",\"bt\":{\"ok\":%s", btAge < BT_STALE_MS ? "true" : "false");
+  if (r.have[SRC_BT_V]) {
+    j.appendf(",\"v\":%.3f", busValue(r, SRC_BT_V, 0));
+    j.appendf(",\"i\":%.2f", busValue(r, SRC_BT_I, 0));
+    j.appendf(",\"p\":%.1f", busValue(r, SRC_BT_P, 0));
+    j.appendf(",\"age\":%lu", btAge);
+  }
+  j.appendf(",\"fails\":%u}", btFailCount);
+  // Measurement age per source and the bus position this view is at
+  j += ",\"age\":{";
+  const char* sep = "";
+  for (uint8_t src = 0; src < SRC_COUNT; src++) {
+    if (!r.have[src]) continue;
+    j.appendf("%s\"%s\":%lu", sep, SRC_NAMES[src], busAgeMs(r, src, esp_timer_get_time()));
+    sep = ",";
+  }
+  j.appendf("},\"seq\":%u,\"drops\":%u", r.next, r.dropped);
   j += "}";
-  server.send(200, "application/json", j);
+  j.send(200, "application/json");
 }
 
 // ============== WEB: THERMAL DATA JSON ==============
@@ -572,19 +929,132 @@ void handleThermalData() {
     return;
   }
 
-  String j = "{\"ok\":true,\"min\":";
-  j += String(mlxMin, 1);
-  j += ",\"max\":";
-  j += String(mlxMax, 1);
-  j += ",\"pixels\":[";
+  RespBuf j;
+  j.appendf("{\"ok\":true,\"min\":%.1f,\"max\":%.1f,\"pixels\":[", mlxMin, mlxMax);
+
+  for (int i = 0; i < MLX_PIXELS; i++) {
+    j.appendf(i > 0 ? ",%.1f" : "%.1f", mlxFrame[i]);
+  }
+  j += "]}";
+
+  j.send(200, "application/json");
+}
+
+// ============== WEB: SESSION MAPS ==============
+// /mapreset[?thr=50]  start a new session, optionally with a new threshold
+// /map?kind=max|maxat|mean|above[&fmt=bin]
+//   json: degC for max/mean, seconds for maxat/above, null = never valid
+//   bin:  row-major little-endian; max/mean int16 centi-degC (INT16_MIN =
+//         no data), maxat/above uint32 ms
+void handleMapReset() {
+  if (!maps.ready) {
+    server.send(500, "application/json", "{\"ok\":false,\"msg\":\"Maps not available\"}");
+    return;
+  }
+  if (server.hasArg("thr")) {
+    maps.thrCc = constrain(server.arg("thr").toFloat(), -20.0, 200.0) * 100;
+  }
+  mapReset(maps, millis());
+  Serial.printf("[MAP] Session reset, threshold %.1f C\n", maps.thrCc / 100.0);
+  server.send(200, "application/json", "{\"ok\":true,\"msg\":\"Session maps reset\"}");
+}
+
+void handleMap() {
+  if (!maps.ready) {
+    server.send(500, "application/json", "{\"ok\":false,\"msg\":\"Maps not available\"}");
+    return;
+  }
+  String kind = server.arg("kind");
+  int k = kind == "max" ? 0 : kind == "maxat" ? 1 : kind == "mean" ? 2 : kind == "above" ? 3 : -1;
+  if (k < 0) {
+    server.send(400, "application/json", "{\"ok\":false,\"msg\":\"kind must be max, maxat, mean or above\"}");
+    return;
+  }
+
+  RespBuf j;
+  if (server.arg("fmt") == "bin") {
+    for (int i = 0; i < MLX_PIXELS; i++) {
+      if (k == 0 || k == 2) {
+        int16_t v = k == 0 ? maps.maxCc[i] : mapMeanCc(maps, i);
+        j.append((const char*)&v, sizeof(v));
+      } else {
+        uint32_t v = k == 1 ? maps.maxAtMs[i] : maps.aboveMs[i];
+        j.append((const char*)&v, sizeof(v));
+      }
+    }
+    server.sendHeader("X-Map-Width", String(MLX_COLS));
+    server.sendHeader("X-Map-Height", String(MLX_ROWS));
+    j.send(200, "application/octet-stream");
+    return;
+  }
 
+  j.appendf("{\"ok\":true,\"kind\":\"%s\",\"w\":%d,\"h\":%d", kind.c_str(), MLX_COLS, MLX_ROWS);
+  j.appendf(",\"thr\":%.1f,\"elapsed\":%lu,\"frames\":%u,\"data\":[",
+    maps.thrCc / 100.0, (millis() - maps.startMs) / 1000, maps.frames);
   for (int i = 0; i < MLX_PIXELS; i++) {
-    if (i > 0) j += ",";
-    j += String(mlxFrame[i], 1);
+    const char* sep = i ? "," : "";
+    if (maps.count[i] == 0) {
+      j.appendf("%snull", sep);
+    } else if (k == 0 || k == 2) {
+      j.appendf("%s%.2f", sep, (k == 0 ? maps.maxCc[i] : mapMeanCc(maps, i)) / 100.0);
+    } else {
+      j.appendf("%s%.1f", sep, (k == 1 ? maps.maxAtMs[i] : maps.aboveMs[i]) / 1000.0);
+    }
   }
   j += "]}";
+  j.send(200, "application/json");
+}
+
+// ============== WEB: BATTERY TESTER CONFIG ==============
+// Readings from the previous tester must not be shown or logged as the new
+// one's. Pending samples are folded in first so none of them reappear.
+void btForgetReadings() {
+  BusReader* readers[] = { &logReader, &webReader };
+  for (BusReader* r : readers) {
+    busDrain(sampleBus, *r);
+    busForget(*r, SRC_BT_V);
+    busForget(*r, SRC_BT_I);
+    busForget(*r, SRC_BT_P);
+  }
+}
 
-  server.send(200, "application/json", j);
+// /btconfig?host=192.168.1.50&port=8080 points the poller elsewhere,
+// e.g. at a stand-in serving a canned /status on a PC
+void handleBtConfig() {
+  char oldHost[sizeof(btHost)];
+  strlcpy(oldHost, btHost, sizeof(oldHost));
+  uint16_t oldPort = btPort;
+  uint16_t port = btPort;
+  // Validate both before touching the poller state
+  if (server.hasArg("host") && !btValidHost(server.arg("host").c_str(), sizeof(btHost))) {
+    server.send(400, "application/json", "{\"ok\":false,\"msg\":\"host must be a name or IP address\"}");
+    return;
+  }
+  if (server.hasArg("port") && !btParsePort(server.arg("port").c_str(), &port)) {
+    server.send(400, "application/json", "{\"ok\":false,\"msg\":\"port must be 1..65535\"}");
+    return;
+  }
+  if (server.hasArg("host")) {
+    strlcpy(btHost, server.arg("host").c_str(), sizeof(btHost));
+  }
+  btPort = port;
+  if (strcmp(oldHost, btHost) != 0 || oldPort != btPort) btForgetReadings();
+  if (server.hasArg("host") || server.hasArg("port")) {
+    btClient.stop();
+    btState = BT_IDLE;
+    btBackoff = BT_POLL_MS;
+    btNextPoll = millis();
+    if (btJob >= 0) schedArm(sched, btJob, btNextPoll);
+    Serial.printf("[BT] Polling http://%s:%u/status\n", btHost, btPort);
+  }
+  RespBuf j;
+  j.appendf("{\"host\":\"%s\"", btHost);
+  j.appendf(",\"port\":%u", btPort);
+  j.appendf(",\"pollMs\":%d", BT_POLL_MS);
+  j.appendf(",\"backoffMs\":%lu", btBackoff);
+  j.appendf(",\"fails\":%u", btFailCount);
+  j += "}";
+  j.send(200, "application/json");
 }
 
 // ============== WEB: RESCAN DS18B20 ==============
@@ -611,7 +1081,8 @@ void handleRescan() {
   // Raw OneWire search
   uint8_t addr[8];
   int found = 0;
-  String j = "{\"addresses\":[";
+  RespBuf j;
+  j += "{\"addresses\":[";
 
   oneWire.reset_search();
   delay(250);
@@ -626,15 +1097,8 @@ void handleRescan() {
   delay(250);
 
   while (oneWire.search(addr)) {
-    if (found > 0) j += ",";
-    j += "\"";
-    for (int i = 0; i < 8; i++) {
-      if (i > 0) j += ":";
-      char hex[3];
-      snprintf(hex, sizeof(hex), "%02X", addr[i]);
-      j += hex;
-    }
-    j += "\"";
+    j.appendf("%s\"%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X\"", found > 0 ? "," : "",
+      addr[0], addr[1], addr[2], addr[3], addr[4], addr[5], addr[6], addr[7]);
 
     Serial.printf("[DS18B20] Device %d: %02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X",
       found, addr[0], addr[1], addr[2], addr[3], addr[4], addr[5], addr[6], addr[7]);
@@ -674,13 +1138,267 @@ void handleRescan() {
   dsSensors.setResolution(12);
   dsSensors.setWaitForConversion(false);
 
-  j += "],\"rawFound\":" + String(found);
-  j += ",\"dsCount\":" + String(dsCount);
-  j += ",\"pin\":" + String(ONE_WIRE_BUS);
-  j += ",\"pinState\":\"" + String(pinState ? "HIGH" : "LOW") + "\"";
+  j.appendf("],\"rawFound\":%d", found);
+  j.appendf(",\"dsCount\":%d", dsCount);
+  j.appendf(",\"pin\":%d", ONE_WIRE_BUS);
+  j.appendf(",\"pinState\":\"%s\"", pinState ? "HIGH" : "LOW");
+  j += "}";
+  j.send(200, "application/json");
+}
+
+// ============== HTTP FIRMWARE UPDATE ==============
+// Compressed, resumable update next to ArduinoOTA. The image is gzipped on
+// the PC, sent in slices and inflated on the fly (ROM tinfl, 32 KB window
+// in otaArena) straight into the inactive OTA slot, erasing sector by
+// sector as it goes. Sampling keeps running: the body loop calls schedRun()
+// after every buffer. State survives dropped connections, so a client
+// resumes at the offset the hub reports.
+//
+//   gzip -9 -k firmware.bin
+//   POST /update/begin?size=<bin bytes>&sha256=<hex of firmware.bin>&enc=gzip
+//   POST /update/chunk              body: next slice of firmware.bin.gz,
+//        X-Update-Offset: <n>, Content-Type: application/octet-stream
+//        (e.g. 64 KB per request)
+//        on any error: GET /update/status and continue from its "offset"
+//   POST /update/finish             checks size + SHA-256, switches slot,
+//                                   reboots
+//
+// The chunk offset is a header, not a query arg: WebServer parses
+// collected headers before the body callback sees RAW_START, whereas the
+// query args are not guaranteed to be there yet.
+//
+// enc=raw sends the uncompressed image through the same path. Decoding and
+// verification live in ota_stream.h; this part owns the flash slot.
+#define OTA_REBOOT_MS     1000
+#define OTA_OFFSET_HEADER "X-Update-Offset"
+
+enum OtaState : uint8_t { OTA_IDLE, OTA_RECEIVING, OTA_VERIFIED, OTA_FAILED };
+
+const char* const OTA_STATE_NAMES[] = { "idle", "receiving", "verified", "failed" };
+
+OtaState otaState = OTA_IDLE;
+const esp_partition_t* otaPart = nullptr;
+esp_ota_handle_t otaHandle = 0;
+OtaStream otaStream;
+unsigned long otaStartMs = 0;
+char otaError[64] = "";
+bool otaChunkOk = false;
+int rebootJob = -1;
+
+// Stream sink: image bytes go straight into the inactive slot
+const char* otaFlashWrite(const uint8_t* data, size_t n) {
+  esp_err_t err = esp_ota_write(otaHandle, data, n);
+  return err == ESP_OK ? nullptr : esp_err_to_name(err);
+}
+
+void setupOta() {
+  otaStream.sink = otaFlashWrite;
+  otaStream.infl = (tinfl_decompressor*)memAlloc(otaArena, sizeof(tinfl_decompressor));
+  otaStream.dict = (uint8_t*)memAlloc(otaArena, OTA_DICT_SIZE);
+  if (!otaStream.infl || !otaStream.dict) {
+    Serial.println("[UPDATE] Arena too small, only enc=raw available");
+  }
+}
+
+void otaFail(const char* why) {
+  if (otaState == OTA_RECEIVING) {
+    esp_ota_abort(otaHandle);
+    otaStreamEnd(otaStream);
+  }
+  otaState = OTA_FAILED;
+  strlcpy(otaError, why, sizeof(otaError));
+  Serial.printf("[UPDATE] Failed at offset %u: %s\n", otaStream.inOffset, why);
+}
+
+// Feed the next slice of the upload; advances the resume offset on success
+bool otaFeed(const uint8_t* in, size_t n) {
+  if (otaState != OTA_RECEIVING) return false;
+  if (otaStreamFeed(otaStream, in, n)) return true;
+  otaFail(otaStream.error);
+  return false;
+}
+
+bool otaBegin(size_t size, const char* shaHex, bool gzip) {
+  // Verified image waiting for the reboot: nothing may replace it now
+  if (otaState == OTA_VERIFIED) return false;
+  if (otaState == OTA_RECEIVING) otaFail("restarted by client");
+  otaState = OTA_IDLE;
+  otaError[0] = 0;
+
+  uint8_t sha[32];
+  if (!otaParseSha(shaHex, sha)) {
+    strlcpy(otaError, "sha256 must be 64 hex digits", sizeof(otaError));
+    return false;
+  }
+  if (gzip && (!otaStream.infl || !otaStream.dict)) {
+    strlcpy(otaError, "no inflate buffer, use enc=raw", sizeof(otaError));
+    return false;
+  }
+  otaPart = esp_ota_get_next_update_partition(nullptr);
+  if (!otaPart || size == 0 || size > otaPart->size) {
+    strlcpy(otaError, otaPart ? "bad image size" : "no OTA partition", sizeof(otaError));
+    return false;
+  }
+  // Sequential writes: sectors are erased as they fill, no multi-second erase up front
+  esp_err_t err = esp_ota_begin(otaPart, OTA_WITH_SEQUENTIAL_WRITES, &otaHandle);
+  if (err != ESP_OK) {
+    strlcpy(otaError, esp_err_to_name(err), sizeof(otaError));
+    return false;
+  }
+
+  otaStreamBegin(otaStream, size, sha, gzip);
+  otaStartMs = millis();
+  otaState = OTA_RECEIVING;
+  Serial.printf("[UPDATE] Receiving %u byte image (%s) into %s\n",
+    size, gzip ? "gzip" : "raw", otaPart->label);
+  return true;
+}
+
+void otaFinish() {
+  if (!otaStreamFinish(otaStream)) {
+    otaFail(otaStream.error);
+    return;
+  }
+  otaStreamEnd(otaStream);
+  // esp_ota_end() also checks the image header, segments and checksum
+  esp_err_t err = esp_ota_end(otaHandle);
+  if (err == ESP_OK) err = esp_ota_set_boot_partition(otaPart);
+  if (err != ESP_OK) {
+    otaState = OTA_FAILED;
+    strlcpy(otaError, esp_err_to_name(err), sizeof(otaError));
+    Serial.printf("[UPDATE] Switching slot failed: %s\n", otaError);
+    return;
+  }
+  otaState = OTA_VERIFIED;
+  Serial.printf("[UPDATE] %u -> %u bytes in %lu ms, verified, rebooting into %s\n",
+    otaStream.inOffset, otaStream.outOffset, millis() - otaStartMs, otaPart->label);
+  flushTempLog();
+  schedArm(sched, rebootJob, schedNowMs(sched) + OTA_REBOOT_MS);
+}
+
+void otaReboot() {
+  ESP.restart();
+}
+
+void otaSendStatus(int code) {
+  RespBuf j;
+  j.appendf("{\"ok\":%s,\"state\":\"%s\"", code == 200 ? "true" : "false",
+    OTA_STATE_NAMES[otaState]);
+  j.appendf(",\"offset\":%u,\"written\":%u,\"size\":%u",
+    otaStream.inOffset, otaStream.outOffset, otaStream.imageSize);
+  j.appendf(",\"enc\":\"%s\",\"elapsedMs\":%lu", otaStream.gzip ? "gzip" : "raw",
+    otaState == OTA_IDLE ? 0 : millis() - otaStartMs);
+  if (otaError[0]) j.appendf(",\"msg\":\"%s\"", otaError);
   j += "}";
+  j.send(code, "application/json");
+}
+
+// ============== WEB: FIRMWARE UPDATE ENDPOINTS ==============
+void handleUpdateBegin() {
+  String sha = server.arg("sha256");
+  size_t size = strtoul(server.arg("size").c_str(), nullptr, 10);
+  String enc = server.arg("enc");
+  if (enc != "gzip" && enc != "raw") {
+    server.send(400, "application/json", "{\"ok\":false,\"msg\":\"enc must be gzip or raw\"}");
+    return;
+  }
+  // Verified and about to reboot: the slot is no longer up for grabs
+  if (otaState == OTA_VERIFIED) {
+    otaSendStatus(409);
+    return;
+  }
+  // Same image already on its way: tell the client where to resume
+  uint8_t want[32];
+  if (otaState == OTA_RECEIVING && !server.hasArg("restart") && size == otaStream.imageSize &&
+      otaParseSha(sha.c_str(), want) && memcmp(want, otaStream.sha, 32) == 0 &&
+      (enc == "gzip") == otaStream.gzip) {
+    otaSendStatus(200);
+    return;
+  }
+  otaSendStatus(otaBegin(size, sha.c_str(), enc == "gzip") ? 200 : 400);
+}
+
+// Runs for every buffer of the request body, before handleUpdateChunk()
+void handleUpdateChunkBody() {
+  HTTPRaw& raw = server.raw();
+  if (raw.status == RAW_START) {
+    String off = server.header(OTA_OFFSET_HEADER);
+    char* end;
+    otaChunkOk = otaState == OTA_RECEIVING && off.length() > 0 &&
+                 strtoul(off.c_str(), &end, 10) == otaStream.inOffset && *end == 0;
+  } else if (raw.status == RAW_WRITE && otaChunkOk) {
+    otaChunkOk = otaFeed(raw.buf, raw.currentSize);
+    schedRun(sched);
+  } else if (raw.status == RAW_ABORTED) {
+    Serial.printf("[UPDATE] Connection dropped, resume at offset %u\n", otaStream.inOffset);
+  }
+}
+
+void handleUpdateChunk() {
+  if (otaState != OTA_RECEIVING) {
+    otaSendStatus(otaState == OTA_FAILED ? 500 : 409);
+  } else {
+    otaSendStatus(otaChunkOk ? 200 : 409);   // 409: resend from "offset"
+  }
+}
+
+void handleUpdateFinish() {
+  if (otaState != OTA_RECEIVING) {
+    otaSendStatus(409);
+    return;
+  }
+  otaFinish();
+  otaSendStatus(otaState == OTA_VERIFIED ? 200 : 500);
+}
+
+void handleUpdateStatus() {
+  otaSendStatus(otaState == OTA_FAILED ? 500 : 200);
+}
+
+// ============== WEB: SCHEDULER STATS ==============
+void handleSched() {
+  RespBuf j;
+  j += "{\"jobs\":[";
+  for (uint8_t id = 0; id < sched.jobCount; id++) {
+    Job& t = sched.jobs[id];
+    j.appendf("%s{\"name\":\"%s\",\"period\":%u,\"deadline\":%u,\"prio\":%u",
+      id ? "," : "", t.name, t.periodMs, t.deadlineMs, t.priority);
+    j.appendf(",\"armed\":%s,\"runs\":%u,\"missed\":%u,\"skipped\":%u",
+      t.heapPos >= 0 ? "true" : "false", t.runs, t.missed, t.skipped);
+    j.appendf(",\"maxLateMs\":%u,\"maxRunUs\":%u}", t.maxLateMs, t.maxRunUs);
+  }
+  j += "]}";
+  j.send(200, "application/json");
+}
+
+// ============== JOBS ==============
+int ledJob = -1;
+
+// LED heartbeat (fast blink when logging)
+void ledBlink() {
+  digitalWrite(BLUE_LED_PIN, !digitalRead(BLUE_LED_PIN));
+  sched.jobs[ledJob].periodMs = loggingEnabled ? 200 : 1000;
+}
 
-  server.send(200, "application/json", j);
+void setupJobs() {
+  uint32_t now = schedNowMs(sched);
+  //                      name      fn              period           deadline prio
+  int mlxJob = schedAdd(sched, "mlx",    mlxRead,        MLX_READ_MS,     100,  1, LATE_SKIP);
+  int dsJob  = schedAdd(sched, "dsReq",  dsRequestTemps, DS_REQUEST_MS,   200,  2, LATE_SKIP);
+  dsReadJob  = schedAdd(sched, "dsRead", dsReadResults,  0,               200,  2, LATE_SKIP);
+  btJob      = schedAdd(sched, "bt",     btPoll,         0,               50,   3, LATE_SKIP);
+  logJob     = schedAdd(sched, "log",    appendTempLog,  LOG_INTERVAL_MS, 500,  4, LATE_SKIP);
+  int memJob = schedAdd(sched, "mem",    memSample,      MEM_SAMPLE_MS,   1000, 6, LATE_SKIP);
+  ledJob     = schedAdd(sched, "led",    ledBlink,       1000,            100,  7, LATE_SKIP);
+  rebootJob  = schedAdd(sched, "reboot", otaReboot,      0,               1000, 0, LATE_SKIP);
+
+  if (mlxConnected) schedArm(sched, mlxJob, now);
+  schedArm(sched, dsJob, now);
+  schedArm(sched, btJob, now);
+  schedArm(sched, logJob, now);
+  schedArm(sched, memJob, now);
+  schedArm(sched, ledJob, now);
+  Serial.printf("[SCHED] %u jobs registered\n", sched.jobCount);
 }
 
 // ============== SETUP ==============
@@ -693,6 +1411,9 @@ void setup() {
   pinMode(BLUE_LED_PIN, OUTPUT);
   digitalWrite(BLUE_LED_PIN, LOW);
 
+  // Arenas first, before WiFi/audio start carving up the heap
+  setupMemory();
+
   // SPIFFS
   initSPIFFS();
 
@@ -704,6 +1425,9 @@ void setup() {
 
   // MLX90640
   setupMLX();
+  setupMaps();
+  setupOta();
+  setupBt();
 
   // WiFi
   Serial.printf("[WIFI] Connecting to %s", WIFI_SSID);
@@ -716,7 +1440,10 @@ void setup() {
 
   // ArduinoOTA
   ArduinoOTA.setHostname("lyrat-sensor");
-  ArduinoOTA.onStart([]() { Serial.println("[OTA] Start"); });
+  ArduinoOTA.onStart([]() {
+    Serial.println("[OTA] Start");
+    if (otaState == OTA_RECEIVING) otaFail("ArduinoOTA took over");
+  });
   ArduinoOTA.onEnd([]() { Serial.println("[OTA] Done"); });
   ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
     Serial.printf("[OTA] %u%%\r", progress * 100 / total);
@@ -738,10 +1465,21 @@ void setup() {
   server.on("/deletelog", handleDeleteLog);
   server.on("/loginfo", handleLogInfo);
   server.on("/say", handleSay);
+  server.on("/btconfig", handleBtConfig);
+  server.on("/mem", handleMem);
+  server.on("/map", handleMap);
+  server.on("/mapreset", handleMapReset);
+  server.on("/sched", handleSched);
+  server.on("/update/begin", HTTP_POST, handleUpdateBegin);
+  server.on("/update/chunk", HTTP_POST, handleUpdateChunk, handleUpdateChunkBody);
+  const char* otaHeaders[] = { OTA_OFFSET_HEADER };
+  server.collectHeaders(otaHeaders, 1);
+  server.on("/update/finish", HTTP_POST, handleUpdateFinish);
+  server.on("/update/status", handleUpdateStatus);
   server.begin();
 
-  // Initial temp request
-  dsRequestTemps();
+  // Periodic work (first DS request goes out right away)
+  setupJobs();
 
   digitalWrite(BLUE_LED_PIN, HIGH);
   Serial.printf("\nReady: http://%s\n", WiFi.localIP().toString().c_str());
@@ -755,37 +1493,15 @@ void loop() {
   ArduinoOTA.handle();
   server.handleClient();
   audio.loop();
-  yield();
-
-  // MLX read (~250ms block at 4Hz, every 500ms)
-  if (mlxConnected) {
-    server.handleClient();
-    mlxRead();
-    server.handleClient();
-    yield();
-  }
-
-  // DS18B20 non-blocking read
-  dsReadResults();
 
-  // Request new temps every 2 seconds
-  static unsigned long lastTempRequest = 0;
-  if (millis() - lastTempRequest > 2000) {
-    lastTempRequest = millis();
-    dsRequestTemps();
-  }
-
-  // Append temp log entry (every 2s when logging)
-  appendTempLog();
-
-  // LED heartbeat (fast blink when logging)
-  static unsigned long lastBlink = 0;
-  unsigned long blinkInterval = loggingEnabled ? 200 : 1000;
-  if (millis() - lastBlink > blinkInterval) {
-    lastBlink = millis();
-    digitalWrite(BLUE_LED_PIN, !digitalRead(BLUE_LED_PIN));
-  }
+  // MLX, DS18B20, battery poll, log, heartbeat
+  schedRun(sched);
+  server.handleClient();
 
-  delay(2);
-  yield();
+  // Sleep until the next job is due, but keep polling HTTP/OTA and feed
+  // the audio stream while it plays
+  uint32_t wait = min(schedNextDueIn(sched),
+                      (uint32_t)(audio.isRunning() ? 1 : SCHED_IDLE_MAX_MS));
+  if (wait > 0) delay(wait);
+  else yield();
 }
@@ -0,0 +1,123 @@
+// ============== MEMORY ARENAS ==============
+// Long-lived buffers are carved out of fixed arenas and pools once at boot,
+// so the internal heap that WiFi, TLS and audio live on does not fragment.
+// MEM_PSRAM is for large, cold or bulk data; MEM_INTERNAL for buffers on a
+// latency-critical path. Without PSRAM an arena falls back to internal RAM.
+//
+// No Arduino dependencies: the backing memory comes from a MemRawAlloc hook
+// (heap_caps on the board, malloc in the native tests).
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum MemPlace { MEM_INTERNAL, MEM_PSRAM };
+
+// Returns nullptr when that kind of memory is absent or exhausted
+typedef void* (*MemRawAlloc)(size_t size, MemPlace place);
+
+struct MemArena {
+  const char* name;
+  MemPlace want;
+  size_t cap;
+  MemPlace got;
+  uint8_t* base;
+  size_t used;
+  size_t highWater;
+  uint32_t fails;
+};
+
+// Fixed-size blocks, free list kept as a bitmask (max 32 blocks)
+#define MEM_POOL_MAX_BLOCKS 32
+
+struct MemPool {
+  const char* name;
+  MemPlace want;
+  size_t blockSize;
+  uint8_t blockCount;
+  MemPlace got;
+  uint8_t* base;
+  uint32_t freeMask;
+  uint8_t inUse;
+  uint8_t highWater;
+  uint32_t fails;
+  uint32_t badPuts;   // foreign, misaligned or already-free pointers
+};
+
+inline uint8_t* memPlace(size_t size, MemPlace want, MemPlace* got, MemRawAlloc rawAlloc) {
+  uint8_t* p = nullptr;
+  if (want == MEM_PSRAM) {
+    p = (uint8_t*)rawAlloc(size, MEM_PSRAM);
+    *got = MEM_PSRAM;
+  }
+  if (!p) {
+    p = (uint8_t*)rawAlloc(size, MEM_INTERNAL);
+    *got = MEM_INTERNAL;
+  }
+  return p;
+}
+
+inline const char* memPlaceName(MemPlace m) {
+  return m == MEM_PSRAM ? "psram" : "internal";
+}
+
+inline void memArenaInit(MemArena& a, MemRawAlloc rawAlloc) {
+  a.base = memPlace(a.cap, a.want, &a.got, rawAlloc);
+  a.used = a.highWater = 0;
+  a.fails = 0;
+}
+
+inline void* memAlloc(MemArena& a, size_t size, size_t align = 4) {
+  size_t start = (a.used + align - 1) & ~(align - 1);
+  if (!a.base || start + size > a.cap) {
+    a.fails++;
+    return nullptr;
+  }
+  a.used = start + size;
+  if (a.used > a.highWater) a.highWater = a.used;
+  return a.base + start;
+}
+
+inline void memReset(MemArena& a) {
+  a.used = 0;
+}
+
+inline void memPoolInit(MemPool& p, MemRawAlloc rawAlloc) {
+  p.base = p.blockCount <= MEM_POOL_MAX_BLOCKS
+    ? memPlace(p.blockSize * p.blockCount, p.want, &p.got, rawAlloc) : nullptr;
+  p.freeMask = p.base ? (uint32_t)((1ULL << p.blockCount) - 1) : 0;
+  p.inUse = p.highWater = 0;
+  p.fails = p.badPuts = 0;
+}
+
+inline void* memPoolGet(MemPool& p) {
+  if (p.freeMask == 0) {
+    p.fails++;
+    return nullptr;
+  }
+  int i = __builtin_ctz(p.freeMask);
+  p.freeMask &= ~(1UL << i);
+  if (++p.inUse > p.highWater) p.highWater = p.inUse;
+  return p.base + i * p.blockSize;
+}
+
+// Only a block handed out by memPoolGet() and not yet returned is taken
+// back; anything else is counted in badPuts and leaves the pool untouched.
+inline bool memPoolPut(MemPool& p, void* block) {
+  if (!block) return true;
+  uintptr_t base = (uintptr_t)p.base;
+  uintptr_t b = (uintptr_t)block;
+  if (!p.base || b < base || b - base >= p.blockSize * p.blockCount ||
+      (b - base) % p.blockSize != 0) {
+    p.badPuts++;
+    return false;
+  }
+  size_t i = (b - base) / p.blockSize;
+  if (p.freeMask & (1UL << i)) {
+    p.badPuts++;
+    return false;
+  }
+  p.freeMask |= 1UL << i;
+  p.inUse--;
+  return true;
+}
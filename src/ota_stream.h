@@ -0,0 +1,196 @@
+// ============== FIRMWARE UPDATE STREAM ==============
+// The decode-and-verify half of the HTTP update: skips the gzip member
+// header, inflates with tinfl into a 32 KB wrapping window, hashes every
+// image byte with SHA-256 and hands it to a sink (esp_ota_write on the
+// board, a buffer in the native tests). Slices may be cut anywhere; after
+// a dropped connection the client resumes at inOffset.
+//
+// Needs only tinfl, mbedtls SHA-256 and the sink; the native tests supply
+// host versions of the first two from test/support.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <esp32/rom/miniz.h>   // ROM inflater (tinfl)
+#include <mbedtls/sha256.h>
+
+#define OTA_DICT_SIZE     TINFL_LZ_DICT_SIZE   // deflate's full 32 KB window
+
+// Writes the next n image bytes; returns nullptr or a static error text
+typedef const char* (*OtaSink)(const uint8_t* data, size_t n);
+
+enum GzState : uint8_t { GZ_FIXED, GZ_EXTRA_LEN, GZ_EXTRA, GZ_NAME, GZ_COMMENT, GZ_HCRC, GZ_BODY };
+
+struct OtaStream {
+  OtaSink sink;
+  tinfl_decompressor* infl;     // nullptr: only raw images
+  uint8_t* dict;
+  bool gzip;
+  size_t imageSize;
+  size_t inOffset;              // upload bytes consumed, the resume offset
+  size_t outOffset;             // image bytes passed to the sink
+  uint8_t sha[32];              // expected SHA-256 of the image
+  mbedtls_sha256_context shaCtx;
+  size_t dictPos;
+  bool streamDone;
+  GzState gzState;
+  uint8_t gzFlags;
+  uint16_t gzCount;             // bytes seen in the current header field
+  uint16_t gzExtraLen;
+  const char* error;            // set once the stream has failed
+};
+
+// 64 hex digits, either case; anything else is rejected
+inline bool otaParseSha(const char* hex, uint8_t out[32]) {
+  if (strlen(hex) != 64) return false;
+  for (int i = 0; i < 64; i++) {
+    char c = hex[i];
+    uint8_t v = c >= '0' && c <= '9' ? c - '0'
+              : c >= 'a' && c <= 'f' ? c - 'a' + 10
+              : c >= 'A' && c <= 'F' ? c - 'A' + 10 : 0xFF;
+    if (v == 0xFF) return false;
+    if (i & 1) out[i / 2] |= v;
+    else out[i / 2] = v << 4;
+  }
+  return true;
+}
+
+inline bool otaStreamFail(OtaStream& s, const char* why) {
+  if (!s.error) s.error = why;
+  return false;
+}
+
+inline bool otaStreamBegin(OtaStream& s, size_t size, const uint8_t sha[32], bool gzip) {
+  s.error = nullptr;
+  if (gzip && (!s.infl || !s.dict)) return otaStreamFail(s, "no inflate buffer, use enc=raw");
+  mbedtls_sha256_init(&s.shaCtx);
+  mbedtls_sha256_starts_ret(&s.shaCtx, 0);
+  memcpy(s.sha, sha, sizeof(s.sha));
+  s.gzip = gzip;
+  s.imageSize = size;
+  s.inOffset = s.outOffset = 0;
+  s.dictPos = 0;
+  s.streamDone = false;
+  s.gzState = GZ_FIXED;
+  s.gzFlags = 0;
+  s.gzCount = 0;
+  s.gzExtraLen = 0;
+  return true;
+}
+
+inline void otaStreamEnd(OtaStream& s) {
+  mbedtls_sha256_free(&s.shaCtx);
+}
+
+inline bool otaEmit(OtaStream& s, const uint8_t* data, size_t n) {
+  if (s.outOffset + n > s.imageSize) return otaStreamFail(s, "image larger than announced");
+  mbedtls_sha256_update_ret(&s.shaCtx, data, n);
+  const char* err = s.sink(data, n);
+  if (err) return otaStreamFail(s, err);
+  s.outOffset += n;
+  return true;
+}
+
+// Move to the next gzip header field whose FLG bit is set
+inline void gzAdvance(OtaStream& s, GzState next) {
+  s.gzCount = 0;
+  if (next == GZ_EXTRA_LEN && !(s.gzFlags & 0x04)) next = GZ_NAME;
+  if (next == GZ_NAME && !(s.gzFlags & 0x08)) next = GZ_COMMENT;
+  if (next == GZ_COMMENT && !(s.gzFlags & 0x10)) next = GZ_HCRC;
+  if (next == GZ_HCRC && !(s.gzFlags & 0x02)) next = GZ_BODY;
+  s.gzState = next;
+  if (next == GZ_BODY) tinfl_init(s.infl);
+}
+
+// Skips the gzip member header; returns how many bytes it consumed
+inline size_t gzHeader(OtaStream& s, const uint8_t* in, size_t n) {
+  size_t used = 0;
+  while (used < n && s.gzState != GZ_BODY) {
+    uint8_t b = in[used++];
+    switch (s.gzState) {
+      case GZ_FIXED:
+        // ID1 ID2 CM FLG MTIME(4) XFL OS
+        if ((s.gzCount == 0 && b != 0x1F) || (s.gzCount == 1 && b != 0x8B) ||
+            (s.gzCount == 2 && b != 8)) {
+          otaStreamFail(s, "not a gzip stream");
+          return used;
+        }
+        if (s.gzCount == 3) s.gzFlags = b;
+        if (++s.gzCount == 10) gzAdvance(s, GZ_EXTRA_LEN);
+        break;
+      case GZ_EXTRA_LEN:
+        if (s.gzCount == 0) s.gzExtraLen = b;
+        else s.gzExtraLen |= b << 8;
+        if (++s.gzCount == 2) {
+          if (s.gzExtraLen) { s.gzState = GZ_EXTRA; s.gzCount = 0; }
+          else gzAdvance(s, GZ_NAME);
+        }
+        break;
+      case GZ_EXTRA:
+        if (--s.gzExtraLen == 0) gzAdvance(s, GZ_NAME);
+        break;
+      case GZ_NAME:
+        if (b == 0) gzAdvance(s, GZ_COMMENT);
+        break;
+      case GZ_COMMENT:
+        if (b == 0) gzAdvance(s, GZ_HCRC);
+        break;
+      case GZ_HCRC:
+        if (++s.gzCount == 2) gzAdvance(s, GZ_BODY);
+        break;
+      default:
+        break;
+    }
+  }
+  return used;
+}
+
+inline bool otaInflate(OtaStream& s, const uint8_t* in, size_t n) {
+  for (;;) {
+    size_t inBytes = n;
+    size_t outBytes = OTA_DICT_SIZE - s.dictPos;
+    tinfl_status st = tinfl_decompress(s.infl, in, &inBytes, s.dict, s.dict + s.dictPos,
+                                       &outBytes, TINFL_FLAG_HAS_MORE_INPUT);
+    in += inBytes;
+    n -= inBytes;
+    if (outBytes > 0 && !otaEmit(s, s.dict + s.dictPos, outBytes)) return false;
+    s.dictPos = (s.dictPos + outBytes) & (OTA_DICT_SIZE - 1);
+    if (st == TINFL_STATUS_DONE) {
+      s.streamDone = true;   // the 8-byte gzip trailer that follows is ignored
+      return true;
+    }
+    if (st < 0) return otaStreamFail(s, "corrupt deflate stream");
+    if (st == TINFL_STATUS_NEEDS_MORE_INPUT && n == 0) return true;
+  }
+}
+
+// Feed the next slice of the upload; advances inOffset on success
+inline bool otaStreamFeed(OtaStream& s, const uint8_t* in, size_t n) {
+  if (s.error) return false;
+  size_t total = n;
+  if (!s.gzip) {
+    if (!otaEmit(s, in, n)) return false;
+  } else {
+    if (s.gzState != GZ_BODY) {
+      size_t used = gzHeader(s, in, n);
+      if (s.error) return false;
+      in += used;
+      n -= used;
+    }
+    if (n > 0 && !s.streamDone && !otaInflate(s, in, n)) return false;
+  }
+  s.inOffset += total;
+  return true;
+}
+
+// Whole image received and matching the announced size and SHA-256
+inline bool otaStreamFinish(OtaStream& s) {
+  if (s.error) return false;
+  if (s.gzip && !s.streamDone) return otaStreamFail(s, "compressed stream incomplete");
+  if (s.outOffset != s.imageSize) return otaStreamFail(s, "image shorter than announced");
+  uint8_t sha[32];
+  mbedtls_sha256_finish_ret(&s.shaCtx, sha);
+  if (memcmp(sha, s.sha, sizeof(sha)) != 0) return otaStreamFail(s, "sha256 mismatch");
+  return true;
+}
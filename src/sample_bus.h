@@ -0,0 +1,127 @@
+// ============== SAMPLE BUS ==============
+// Every scalar reading is published once as a timestamped Sample into a
+// single-producer ring (the loop task). Each consumer owns a BusReader,
+// drains it at its own pace and sees gaps in seq as drops. Slots are
+// guarded seqlock-style, so a reader that gets lapped mid-copy discards
+// the torn sample instead of returning it.
+//
+// The slot payload is held in relaxed atomic words rather than a plain
+// Sample, so a torn copy is a detected retry and not a data race; on the
+// ESP32 these compile to ordinary 32-bit loads and stores.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <atomic>
+
+enum SampleSource : uint8_t {
+  SRC_DS1, SRC_DS2, SRC_MLX_MAX, SRC_MLX_MIN, SRC_MLX_AVG,
+  SRC_BT_V, SRC_BT_I, SRC_BT_P, SRC_COUNT
+};
+
+const char* const SRC_NAMES[SRC_COUNT] = {
+  "t1", "t2", "mlxMax", "mlxMin", "mlxAvg", "v", "i", "p"
+};
+
+#define SQ_OK        0x00
+#define SQ_REJECTED  0x01   // outside sensor range, value is the raw reading
+#define SQ_PARTIAL   0x02   // MLX frame with out-of-range pixels excluded
+
+struct Sample {
+  int64_t tUs;        // esp_timer time of the measurement
+  uint32_t seq;       // bus position, gaps mean drops
+  float value;
+  uint8_t src;
+  uint8_t flags;
+};
+
+#define BUS_SLOTS 64        // power of two
+#define SAMPLE_WORDS ((sizeof(Sample) + 3) / 4)
+
+struct BusSlot {
+  std::atomic<uint32_t> stamp;  // seq + 1 once written, 0 while writing
+  std::atomic<uint32_t> words[SAMPLE_WORDS];
+};
+
+struct SampleBus {
+  BusSlot slots[BUS_SLOTS];
+  std::atomic<uint32_t> head;   // samples published so far
+};
+
+struct BusReader {
+  const char* name;
+  uint32_t next;
+  uint32_t dropped;
+  Sample latest[SRC_COUNT];
+  bool have[SRC_COUNT];
+};
+
+inline void busPublish(SampleBus& bus, uint8_t src, float value, uint8_t flags, int64_t tUs) {
+  uint32_t pos = bus.head.load(std::memory_order_relaxed);
+  BusSlot& slot = bus.slots[pos & (BUS_SLOTS - 1)];
+  uint32_t w[SAMPLE_WORDS] = {};
+  Sample s;
+  memset(&s, 0, sizeof(s));
+  s.tUs = tUs;
+  s.seq = pos;
+  s.value = value;
+  s.src = src;
+  s.flags = flags;
+  memcpy(w, &s, sizeof(s));
+  slot.stamp.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (size_t k = 0; k < SAMPLE_WORDS; k++) slot.words[k].store(w[k], std::memory_order_relaxed);
+  slot.stamp.store(pos + 1, std::memory_order_release);
+  bus.head.store(pos + 1, std::memory_order_release);
+}
+
+// Next unread sample for this reader; false once caught up
+inline bool busRead(const SampleBus& bus, BusReader& r, Sample* out) {
+  for (;;) {
+    uint32_t head = bus.head.load(std::memory_order_acquire);
+    if (r.next == head) return false;
+    if (head - r.next > BUS_SLOTS) {
+      r.dropped += head - r.next - BUS_SLOTS;
+      r.next = head - BUS_SLOTS;
+    }
+    const BusSlot& slot = bus.slots[r.next & (BUS_SLOTS - 1)];
+    uint32_t s1 = slot.stamp.load(std::memory_order_acquire);
+    uint32_t w[SAMPLE_WORDS];
+    for (size_t k = 0; k < SAMPLE_WORDS; k++) w[k] = slot.words[k].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint32_t s2 = slot.stamp.load(std::memory_order_relaxed);
+    if (s1 == r.next + 1 && s2 == s1) {
+      r.next++;
+      memcpy(out, w, sizeof(Sample));
+      return true;
+    }
+    // Overwritten while we were copying it
+    r.dropped++;
+    r.next++;
+  }
+}
+
+// Fold everything pending into the reader's latest-per-source view
+inline void busDrain(const SampleBus& bus, BusReader& r) {
+  Sample s;
+  while (busRead(bus, r, &s)) {
+    if (s.src >= SRC_COUNT || (s.flags & SQ_REJECTED)) continue;
+    r.latest[s.src] = s;
+    r.have[s.src] = true;
+  }
+}
+
+// Drop a source from the reader's view until it is published again
+inline void busForget(BusReader& r, uint8_t src) {
+  r.have[src] = false;
+}
+
+inline float busValue(const BusReader& r, uint8_t src, float fallback) {
+  return r.have[src] ? r.latest[src].value : fallback;
+}
+
+inline unsigned long busAgeMs(const BusReader& r, uint8_t src, int64_t nowUs) {
+  if (!r.have[src]) return ULONG_MAX;
+  return (nowUs - r.latest[src].tUs) / 1000;
+}
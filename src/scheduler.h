@@ -0,0 +1,179 @@
+// ============== SCHEDULER ==============
+// Cooperative deadline scheduler for the periodic work in loop(). Armed
+// jobs sit in a min-heap on due time; each schedRun() pops everything that
+// is due, runs it once in priority order and re-arms it. A job started
+// more than deadlineMs after its due time counts as missed. A periodic job
+// that fell a whole period behind either skips the lost runs (LATE_SKIP,
+// stays phase-locked) or runs them back to back, at most SCHED_MAX_BURST
+// periods' worth (LATE_BURST). loop() sleeps until the next due time.
+//
+// Due times, lateness, re-arming and run time all come from the one clock
+// hook (esp_timer on the board, whose /1000 is what millis() returns; a
+// simulated clock in the native tests).
+#pragma once
+
+#include <stdint.h>
+
+enum LatePolicy : uint8_t { LATE_SKIP, LATE_BURST };
+
+typedef void (*JobFn)();
+typedef int64_t (*SchedClock)();    // microseconds, monotonic
+
+struct Job {
+  const char* name;
+  JobFn fn;
+  uint32_t periodMs;      // 0 = one-shot, re-armed explicitly
+  uint32_t deadlineMs;
+  uint8_t priority;       // lower runs first when due together
+  LatePolicy late;
+  int8_t heapPos;         // -1 when not armed
+  uint32_t due;
+  uint32_t runs;
+  uint32_t missed;
+  uint32_t skipped;
+  uint32_t maxLateMs;
+  uint32_t maxRunUs;
+};
+
+#define SCHED_MAX_JOBS    12
+#define SCHED_MAX_BURST   3
+#define SCHED_IDLE_MAX_MS 10    // longest sleep, keeps HTTP/OTA responsive
+
+struct Scheduler {
+  SchedClock clockUs;
+  Job jobs[SCHED_MAX_JOBS];
+  uint8_t jobCount;
+  uint8_t heap[SCHED_MAX_JOBS];
+  uint8_t heapLen;
+  bool running;
+};
+
+inline uint32_t schedNowMs(const Scheduler& s) {
+  return (uint32_t)(s.clockUs() / 1000);
+}
+
+inline bool schedBefore(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) < 0;
+}
+
+inline void schedHeapSet(Scheduler& s, uint8_t pos, uint8_t id) {
+  s.heap[pos] = id;
+  s.jobs[id].heapPos = pos;
+}
+
+inline void schedSiftUp(Scheduler& s, uint8_t pos) {
+  uint8_t id = s.heap[pos];
+  while (pos > 0) {
+    uint8_t parent = (pos - 1) / 2;
+    if (!schedBefore(s.jobs[id].due, s.jobs[s.heap[parent]].due)) break;
+    schedHeapSet(s, pos, s.heap[parent]);
+    pos = parent;
+  }
+  schedHeapSet(s, pos, id);
+}
+
+inline void schedSiftDown(Scheduler& s, uint8_t pos) {
+  uint8_t id = s.heap[pos];
+  for (;;) {
+    uint8_t child = pos * 2 + 1;
+    if (child >= s.heapLen) break;
+    if (child + 1 < s.heapLen &&
+        schedBefore(s.jobs[s.heap[child + 1]].due, s.jobs[s.heap[child]].due)) {
+      child++;
+    }
+    if (!schedBefore(s.jobs[s.heap[child]].due, s.jobs[id].due)) break;
+    schedHeapSet(s, pos, s.heap[child]);
+    pos = child;
+  }
+  schedHeapSet(s, pos, id);
+}
+
+inline void schedDisarm(Scheduler& s, uint8_t id) {
+  int8_t pos = s.jobs[id].heapPos;
+  if (pos < 0) return;
+  s.jobs[id].heapPos = -1;
+  if (--s.heapLen == pos) return;
+  schedHeapSet(s, pos, s.heap[s.heapLen]);
+  schedSiftDown(s, pos);
+  schedSiftUp(s, s.jobs[s.heap[pos]].heapPos);
+}
+
+// (Re)arm a job to run at dueMs
+inline void schedArm(Scheduler& s, uint8_t id, uint32_t dueMs) {
+  schedDisarm(s, id);
+  s.jobs[id].due = dueMs;
+  schedHeapSet(s, s.heapLen, id);
+  schedSiftUp(s, s.heapLen++);
+}
+
+// Job id, or -1 when the table is full
+inline int schedAdd(Scheduler& s, const char* name, JobFn fn, uint32_t periodMs,
+                    uint32_t deadlineMs, uint8_t priority, LatePolicy late) {
+  if (s.jobCount >= SCHED_MAX_JOBS) return -1;
+  uint8_t id = s.jobCount++;
+  s.jobs[id] = { name, fn, periodMs, deadlineMs, priority, late, -1 };
+  return id;
+}
+
+inline void schedReschedule(Scheduler& s, uint8_t id, uint32_t now) {
+  Job& j = s.jobs[id];
+  if (j.periodMs == 0) return;
+  uint32_t next = j.due + j.periodMs;
+  if (!schedBefore(now, next)) {
+    // At least one whole period behind
+    uint32_t behind = (now - j.due) / j.periodMs;
+    uint32_t drop = j.late == LATE_SKIP ? behind
+                  : behind > SCHED_MAX_BURST ? behind - SCHED_MAX_BURST : 0;
+    j.skipped += drop;
+    next += drop * j.periodMs;
+  }
+  schedArm(s, id, next);
+}
+
+// Run every job that is due now once, highest priority first
+inline void schedRun(Scheduler& s) {
+  // Also called from the HTTP update body loop; never nest
+  if (s.running) return;
+  s.running = true;
+
+  uint32_t now = schedNowMs(s);
+  uint8_t due[SCHED_MAX_JOBS];
+  uint8_t n = 0;
+  while (s.heapLen > 0 && !schedBefore(now, s.jobs[s.heap[0]].due)) {
+    uint8_t id = s.heap[0];
+    schedDisarm(s, id);
+    // Insertion sort on priority, stable for equal priorities
+    uint8_t k = n++;
+    while (k > 0 && s.jobs[due[k - 1]].priority > s.jobs[id].priority) {
+      due[k] = due[k - 1];
+      k--;
+    }
+    due[k] = id;
+  }
+
+  for (uint8_t k = 0; k < n; k++) {
+    Job& j = s.jobs[due[k]];
+    if (j.heapPos >= 0) continue;   // re-armed by a job earlier in this batch
+    // Re-read the clock per job: earlier jobs in the batch take time too
+    int64_t t0 = s.clockUs();
+    uint32_t late = (uint32_t)(t0 / 1000) - j.due;
+    if (late > j.deadlineMs) j.missed++;
+    if (late > j.maxLateMs) j.maxLateMs = late;
+    j.fn();
+    int64_t t1 = s.clockUs();
+    uint32_t runUs = t1 - t0;
+    if (runUs > j.maxRunUs) j.maxRunUs = runUs;
+    j.runs++;
+    // The job may have re-armed itself (one-shots, btPoll)
+    if (j.heapPos < 0) schedReschedule(s, due[k], (uint32_t)(t1 / 1000));
+  }
+  s.running = false;
+}
+
+// ms until the earliest armed job is due (0 = now)
+inline uint32_t schedNextDueIn(const Scheduler& s) {
+  if (s.heapLen == 0) return UINT32_MAX;
+  uint32_t now = schedNowMs(s);
+  uint32_t due = s.jobs[s.heap[0]].due;
+  return schedBefore(now, due) ? due - now : 0;
+}
@@ -0,0 +1,88 @@
+// ============== SESSION MAPS ==============
+// Per-pixel accumulators over the session, updated inside mlxRead()'s pixel
+// loop: max-hold with the time it was hit, mean, and time spent above a
+// threshold. Fixed-point arrays carved from one arena, 22 bytes per pixel
+// (16.9 KB for the 768-pixel MLX90640); the update is a handful of integer
+// ops per pixel, far below the 15 ms frame budget at 64 Hz.
+//
+// No Arduino dependencies: times are passed in as ms since boot.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "mem_arena.h"
+
+#define MAP_DEFAULT_THR_C  45.0
+#define MAP_NO_DATA        INT16_MIN
+
+#define MAP_BYTES_PER_PIXEL \
+  (sizeof(int16_t) + sizeof(uint32_t) + sizeof(int64_t) + 2 * sizeof(uint32_t))
+// Arena size for the layout in mapInit(): the arrays plus worst-case
+// alignment padding in front of the uint32 and int64 arrays
+#define MAP_ARENA_BYTES(pixels)  ((pixels) * MAP_BYTES_PER_PIXEL + 8)
+
+struct SessionMaps {
+  int16_t*  maxCc;      // max temp, centi-degC
+  uint32_t* maxAtMs;    // ms into the session when the max was hit
+  int64_t*  sumCc;      // sum of centi-degC, mean = sum / count
+  uint32_t* count;      // frames this pixel was valid
+  uint32_t* aboveMs;    // ms spent above thrCc
+  int pixels;
+  bool ready;
+  int16_t thrCc;
+  uint32_t startMs;
+  uint32_t lastFrameMs;
+  uint32_t frames;
+  // Per-frame values shared by every pixel update
+  uint32_t nowMs;
+  uint32_t dtMs;
+};
+
+inline void mapReset(SessionMaps& m, uint32_t nowMs) {
+  if (!m.ready) return;
+  for (int i = 0; i < m.pixels; i++) m.maxCc[i] = MAP_NO_DATA;
+  memset(m.maxAtMs, 0, m.pixels * sizeof(uint32_t));
+  memset(m.sumCc, 0, m.pixels * sizeof(int64_t));
+  memset(m.count, 0, m.pixels * sizeof(uint32_t));
+  memset(m.aboveMs, 0, m.pixels * sizeof(uint32_t));
+  m.startMs = nowMs;
+  m.lastFrameMs = 0;
+  m.frames = 0;
+}
+
+// False when the arena cannot hold all five arrays; maps stay disabled
+inline bool mapInit(SessionMaps& m, MemArena& a, int pixels, uint32_t nowMs) {
+  m.pixels = pixels;
+  m.thrCc = MAP_DEFAULT_THR_C * 100;
+  m.maxCc   = (int16_t*)memAlloc(a, pixels * sizeof(int16_t));
+  m.maxAtMs = (uint32_t*)memAlloc(a, pixels * sizeof(uint32_t));
+  m.sumCc   = (int64_t*)memAlloc(a, pixels * sizeof(int64_t), 8);
+  m.count   = (uint32_t*)memAlloc(a, pixels * sizeof(uint32_t));
+  m.aboveMs = (uint32_t*)memAlloc(a, pixels * sizeof(uint32_t));
+  m.ready = m.maxCc && m.maxAtMs && m.sumCc && m.count && m.aboveMs;
+  mapReset(m, nowMs);
+  return m.ready;
+}
+
+inline void mapBeginFrame(SessionMaps& m, uint32_t nowMs) {
+  m.nowMs = nowMs - m.startMs;
+  m.dtMs = m.frames ? m.nowMs - m.lastFrameMs : 0;
+  m.lastFrameMs = m.nowMs;
+  m.frames++;
+}
+
+inline void mapAccumulate(SessionMaps& m, int i, float t) {
+  int16_t c = (int16_t)(t * 100 + (t >= 0 ? 0.5f : -0.5f));
+  if (c > m.maxCc[i]) {
+    m.maxCc[i] = c;
+    m.maxAtMs[i] = m.nowMs;
+  }
+  m.sumCc[i] += c;
+  m.count[i]++;
+  if (c > m.thrCc) m.aboveMs[i] += m.dtMs;
+}
+
+inline int16_t mapMeanCc(const SessionMaps& m, int i) {
+  return m.count[i] ? (int16_t)(m.sumCc[i] / (int64_t)m.count[i]) : MAP_NO_DATA;
+}
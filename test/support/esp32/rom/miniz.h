@@ -0,0 +1,305 @@
+// Host stand-in for the ESP32 ROM tinfl used by ota_stream.h (native tests
+// only). A resumable raw-deflate decoder written to tinfl's interface and,
+// above all, its window semantics, so the tests exercise the same wrapping
+// logic as the board:
+//   - the decoder has no window of its own; back-references are read from
+//     the caller's buffer at (pos - dist) & mask
+//   - mask is (outNext - outStart) + *outBytes - 1 and must be a power of
+//     two minus one, i.e. every call may fill up to the end of the window
+//   - HAS_MORE_OUTPUT is returned only when the window end is reached with
+//     output still pending; the state survives across calls
+//   - without TINFL_FLAG_HAS_MORE_INPUT a short input reads as zero bytes
+//   - on DONE, whole bytes still in the bit buffer are given back
+//   - FAILED and DONE are sticky until tinfl_init()
+// Only the flags ota_stream.h can use are provided (no zlib header/adler).
+// Huffman decoding is canonical and bit by bit, as in zlib's puff.c: slow,
+// but short and easy to check against RFC 1951.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TINFL_LZ_DICT_SIZE 32768
+#define TINFL_FLAG_HAS_MORE_INPUT 2
+#define TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF 4
+
+enum tinfl_status {
+  TINFL_STATUS_BAD_PARAM = -3,
+  TINFL_STATUS_ADLER32_MISMATCH = -2,
+  TINFL_STATUS_FAILED = -1,
+  TINFL_STATUS_DONE = 0,
+  TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+  TINFL_STATUS_HAS_MORE_OUTPUT = 2
+};
+
+struct tinfl_huff {
+  int16_t count[16];      // codes per length
+  int16_t symbol[288];    // symbols ordered by code
+};
+
+struct tinfl_decompressor {
+  uint32_t state;         // resume point, 0 = start of stream
+  uint32_t bitBuf;
+  uint32_t numBits;
+  uint32_t final;
+  uint32_t type;
+  uint32_t lit;
+  uint32_t len;
+  uint32_t dist;
+  uint32_t sym;
+  uint32_t nlen;
+  uint32_t ndist;
+  uint32_t ncode;
+  uint32_t index;
+  uint32_t hcode;         // bit-by-bit decode in progress
+  uint32_t hfirst;
+  uint32_t hindex;
+  uint32_t hlen;
+  uint64_t total;         // bytes output since tinfl_init()
+  uint8_t lengths[320];
+  tinfl_huff lencode;
+  tinfl_huff distcode;
+};
+
+inline void tinfl_init(tinfl_decompressor* r) {
+  r->state = 0;
+}
+
+// Canonical code from per-symbol lengths; 0 complete, >0 incomplete,
+// <0 over-subscribed
+inline int tinfl_build(tinfl_huff* h, const uint8_t* lengths, int n) {
+  for (int len = 0; len < 16; len++) h->count[len] = 0;
+  for (int s = 0; s < n; s++) h->count[lengths[s]]++;
+  if (h->count[0] == n) return 0;
+  int left = 1;
+  for (int len = 1; len < 16; len++) {
+    left <<= 1;
+    left -= h->count[len];
+    if (left < 0) return left;
+  }
+  int16_t offs[16];
+  offs[1] = 0;
+  for (int len = 1; len < 15; len++) offs[len + 1] = offs[len] + h->count[len];
+  for (int s = 0; s < n; s++) {
+    if (lengths[s]) h->symbol[offs[lengths[s]]++] = s;
+  }
+  return left;
+}
+
+// Resume points below 0x100 are the numbered suspensions in the body
+#define TINFL_STATE_DONE    0x100
+#define TINFL_STATE_FAILED  0x101
+
+#define TINFL_CR_RETURN(idx, st) \
+  do { status = (st); r->state = (idx); goto suspend; case (idx):; } while (0)
+
+#define TINFL_GET_BYTE(idx, c) \
+  do { \
+    while (inCur >= inEnd) { \
+      if (!(flags & TINFL_FLAG_HAS_MORE_INPUT)) break; \
+      TINFL_CR_RETURN(idx, TINFL_STATUS_NEEDS_MORE_INPUT); \
+    } \
+    c = inCur < inEnd ? *inCur++ : 0; \
+  } while (0)
+
+#define TINFL_GET_BITS(idx, out, n) \
+  do { \
+    while (r->numBits < (n)) { \
+      TINFL_GET_BYTE(idx, c); \
+      r->bitBuf |= c << r->numBits; \
+      r->numBits += 8; \
+    } \
+    out = r->bitBuf & ((1u << (n)) - 1); \
+    r->bitBuf >>= (n); \
+    r->numBits -= (n); \
+  } while (0)
+
+#define TINFL_HUFF_DECODE(idx, out, h) \
+  do { \
+    r->hcode = r->hfirst = r->hindex = 0; \
+    for (r->hlen = 1;; r->hlen++) { \
+      if (r->hlen > 15) goto fail; \
+      TINFL_GET_BITS(idx, c, 1); \
+      r->hcode |= c; \
+      c = (h).count[r->hlen]; \
+      if (r->hcode < r->hfirst + c) { \
+        out = (h).symbol[r->hindex + (r->hcode - r->hfirst)]; \
+        break; \
+      } \
+      r->hindex += c; \
+      r->hfirst = (r->hfirst + c) << 1; \
+      r->hcode <<= 1; \
+    } \
+  } while (0)
+
+#define TINFL_PUT(idx, expr) \
+  do { \
+    while (outCur >= outEnd) TINFL_CR_RETURN(idx, TINFL_STATUS_HAS_MORE_OUTPUT); \
+    *outCur = (expr); \
+    outCur++; \
+    r->total++; \
+  } while (0)
+
+inline tinfl_status tinfl_decompress(tinfl_decompressor* r, const uint8_t* in, size_t* inBytes,
+                                     uint8_t* outStart, uint8_t* outNext, size_t* outBytes,
+                                     uint32_t flags) {
+  static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+  static const uint16_t lbase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                      35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+  static const uint8_t lext[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+  static const uint16_t dbase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                      257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                      8193, 12289, 16385, 24577 };
+  static const uint8_t dext[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+  size_t mask = flags & TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF
+              ? (size_t)-1 : (size_t)(outNext - outStart) + *outBytes - 1;
+  if (outNext < outStart || ((mask + 1) & mask) != 0) {
+    *inBytes = *outBytes = 0;
+    return TINFL_STATUS_BAD_PARAM;
+  }
+  const uint8_t* inCur = in;
+  const uint8_t* inEnd = in + *inBytes;
+  uint8_t* outCur = outNext;
+  uint8_t* outEnd = outNext + *outBytes;
+  tinfl_status status = TINFL_STATUS_FAILED;
+  uint32_t c = 0;
+  int err = 0;
+
+  switch (r->state) {
+    case 0:
+      r->bitBuf = r->numBits = 0;
+      r->total = 0;
+      do {
+        TINFL_GET_BITS(1, r->final, 1);
+        TINFL_GET_BITS(2, r->type, 2);
+        if (r->type == 0) {
+          // Stored: drop to a byte boundary, LEN and its complement
+          r->bitBuf >>= r->numBits & 7;
+          r->numBits -= r->numBits & 7;
+          TINFL_GET_BITS(3, r->len, 16);
+          TINFL_GET_BITS(4, r->nlen, 16);
+          if (r->len != (~r->nlen & 0xFFFF)) goto fail;
+          for (; r->len > 0; r->len--) {
+            TINFL_GET_BITS(5, r->lit, 8);
+            TINFL_PUT(6, (uint8_t)r->lit);
+          }
+          continue;
+        }
+        if (r->type == 3) goto fail;
+
+        if (r->type == 1) {
+          for (int s = 0; s < 288; s++) r->lengths[s] = s < 144 ? 8 : s < 256 ? 9 : s < 280 ? 7 : 8;
+          tinfl_build(&r->lencode, r->lengths, 288);
+          for (int s = 0; s < 30; s++) r->lengths[s] = 5;
+          tinfl_build(&r->distcode, r->lengths, 30);
+        } else {
+          TINFL_GET_BITS(7, r->nlen, 5);
+          r->nlen += 257;
+          TINFL_GET_BITS(8, r->ndist, 5);
+          r->ndist += 1;
+          TINFL_GET_BITS(9, r->ncode, 4);
+          r->ncode += 4;
+          if (r->nlen > 286 || r->ndist > 30) goto fail;
+          for (r->index = 0; r->index < 19; r->index++) r->lengths[order[r->index]] = 0;
+          for (r->index = 0; r->index < r->ncode; r->index++) {
+            TINFL_GET_BITS(10, r->lit, 3);
+            r->lengths[order[r->index]] = r->lit;
+          }
+          // The code-length code must be complete
+          if (tinfl_build(&r->lencode, r->lengths, 19) != 0) goto fail;
+
+          for (r->index = 0; r->index < r->nlen + r->ndist;) {
+            TINFL_HUFF_DECODE(11, r->sym, r->lencode);
+            if (r->sym < 16) {
+              r->lengths[r->index++] = r->sym;
+              continue;
+            }
+            if (r->sym == 16) {
+              if (r->index == 0) goto fail;
+              r->lit = r->lengths[r->index - 1];
+              TINFL_GET_BITS(12, r->len, 2);
+              r->len += 3;
+            } else if (r->sym == 17) {
+              r->lit = 0;
+              TINFL_GET_BITS(13, r->len, 3);
+              r->len += 3;
+            } else {
+              r->lit = 0;
+              TINFL_GET_BITS(14, r->len, 7);
+              r->len += 11;
+            }
+            if (r->index + r->len > r->nlen + r->ndist) goto fail;
+            while (r->len--) r->lengths[r->index++] = r->lit;
+          }
+          if (r->lengths[256] == 0) goto fail;   // no end-of-block code
+          // Incomplete codes are only allowed with a single code
+          err = tinfl_build(&r->lencode, r->lengths, r->nlen);
+          if (err && (err < 0 || (int)r->nlen != r->lencode.count[0] + r->lencode.count[1])) goto fail;
+          err = tinfl_build(&r->distcode, r->lengths + r->nlen, r->ndist);
+          if (err && (err < 0 || (int)r->ndist != r->distcode.count[0] + r->distcode.count[1])) goto fail;
+        }
+
+        for (;;) {
+          TINFL_HUFF_DECODE(15, r->sym, r->lencode);
+          if (r->sym < 256) {
+            TINFL_PUT(16, (uint8_t)r->sym);
+            continue;
+          }
+          if (r->sym == 256) break;
+          r->sym -= 257;
+          if (r->sym >= 29) goto fail;
+          r->len = lbase[r->sym];
+          TINFL_GET_BITS(17, r->lit, lext[r->sym]);
+          r->len += r->lit;
+          TINFL_HUFF_DECODE(18, r->sym, r->distcode);
+          if (r->sym >= 30) goto fail;
+          r->dist = dbase[r->sym];
+          TINFL_GET_BITS(19, r->lit, dext[r->sym]);
+          r->dist += r->lit;
+          if (r->dist > r->total) goto fail;
+          if ((flags & TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF) &&
+              r->dist > (size_t)(outCur - outStart)) {
+            goto fail;
+          }
+          // The window is the caller's buffer, wrapped at mask
+          for (; r->len > 0; r->len--) {
+            TINFL_PUT(20, outStart[((size_t)(outCur - outStart) - r->dist) & mask]);
+          }
+        }
+      } while (!r->final);
+
+      // Give back whole bytes fetched from this call's input but not used
+      while (inCur > in && r->numBits >= 8) {
+        inCur--;
+        r->numBits -= 8;
+      }
+      r->state = TINFL_STATE_DONE;
+      status = TINFL_STATUS_DONE;
+      goto suspend;
+
+    case TINFL_STATE_DONE:
+      status = TINFL_STATUS_DONE;
+      goto suspend;
+
+    case TINFL_STATE_FAILED:
+    default:
+      goto fail;
+  }
+
+fail:
+  r->state = TINFL_STATE_FAILED;
+  status = TINFL_STATUS_FAILED;
+suspend:
+  *inBytes = inCur - in;
+  *outBytes = outCur - outNext;
+  return status;
+}
+
+#undef TINFL_CR_RETURN
+#undef TINFL_GET_BYTE
+#undef TINFL_GET_BITS
+#undef TINFL_HUFF_DECODE
+#undef TINFL_PUT
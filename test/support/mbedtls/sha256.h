@@ -0,0 +1,99 @@
+// Host stand-in for the ESP-IDF 4.4 mbedtls SHA-256 calls used by
+// ota_stream.h (native tests only). Plain FIPS 180-4, no dependencies.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+struct mbedtls_sha256_context {
+  uint32_t h[8];
+  uint64_t len;
+  uint8_t buf[64];
+  size_t bufLen;
+};
+
+static const uint32_t SHA256_K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline uint32_t sha256Rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+inline void sha256Block(mbedtls_sha256_context* c, const uint8_t* p) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; i++) {
+    w[i] = (uint32_t)p[i * 4] << 24 | (uint32_t)p[i * 4 + 1] << 16 | (uint32_t)p[i * 4 + 2] << 8 | p[i * 4 + 3];
+  }
+  for (int i = 16; i < 64; i++) {
+    uint32_t s0 = sha256Rotr(w[i - 15], 7) ^ sha256Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = sha256Rotr(w[i - 2], 17) ^ sha256Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t a = c->h[0], b = c->h[1], cc = c->h[2], d = c->h[3];
+  uint32_t e = c->h[4], f = c->h[5], g = c->h[6], h = c->h[7];
+  for (int i = 0; i < 64; i++) {
+    uint32_t t1 = h + (sha256Rotr(e, 6) ^ sha256Rotr(e, 11) ^ sha256Rotr(e, 25)) +
+                  ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+    uint32_t t2 = (sha256Rotr(a, 2) ^ sha256Rotr(a, 13) ^ sha256Rotr(a, 22)) +
+                  ((a & b) ^ (a & cc) ^ (b & cc));
+    h = g; g = f; f = e; e = d + t1;
+    d = cc; cc = b; b = a; a = t1 + t2;
+  }
+  c->h[0] += a; c->h[1] += b; c->h[2] += cc; c->h[3] += d;
+  c->h[4] += e; c->h[5] += f; c->h[6] += g; c->h[7] += h;
+}
+
+inline void mbedtls_sha256_init(mbedtls_sha256_context* c) { memset(c, 0, sizeof(*c)); }
+inline void mbedtls_sha256_free(mbedtls_sha256_context* c) { memset(c, 0, sizeof(*c)); }
+
+inline int mbedtls_sha256_starts_ret(mbedtls_sha256_context* c, int is224) {
+  static const uint32_t iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+  if (is224) return -1;
+  memcpy(c->h, iv, sizeof(iv));
+  c->len = 0;
+  c->bufLen = 0;
+  return 0;
+}
+
+inline int mbedtls_sha256_update_ret(mbedtls_sha256_context* c, const uint8_t* in, size_t n) {
+  c->len += n;
+  while (n > 0) {
+    size_t take = 64 - c->bufLen < n ? 64 - c->bufLen : n;
+    memcpy(c->buf + c->bufLen, in, take);
+    c->bufLen += take;
+    in += take;
+    n -= take;
+    if (c->bufLen == 64) {
+      sha256Block(c, c->buf);
+      c->bufLen = 0;
+    }
+  }
+  return 0;
+}
+
+inline int mbedtls_sha256_finish_ret(mbedtls_sha256_context* c, uint8_t out[32]) {
+  uint64_t bits = c->len * 8;
+  uint8_t pad = 0x80;
+  mbedtls_sha256_update_ret(c, &pad, 1);
+  pad = 0;
+  while (c->bufLen != 56) mbedtls_sha256_update_ret(c, &pad, 1);
+  uint8_t lenBytes[8];
+  for (int i = 0; i < 8; i++) lenBytes[i] = (uint8_t)(bits >> (56 - i * 8));
+  mbedtls_sha256_update_ret(c, lenBytes, 8);
+  for (int i = 0; i < 8; i++) {
+    out[i * 4] = c->h[i] >> 24;
+    out[i * 4 + 1] = c->h[i] >> 16;
+    out[i * 4 + 2] = c->h[i] >> 8;
+    out[i * 4 + 3] = c->h[i];
+  }
+  return 0;
+}
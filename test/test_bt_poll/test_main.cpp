@@ -0,0 +1,148 @@
+// Native tests for bt_status.h: canned replies as a stand-in tester (or a
+// broken one) would send them to the hub's GET /status poll, and the
+// /btconfig host and port checks.
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bt_status.h"
+
+static char resp[BT_RESP_MAX];
+static BtReading r;
+
+// Copies a reply into the poll buffer the way btStep() fills it
+static const char* parse(const char* reply) {
+  size_t len = strlen(reply);
+  if (len > BT_RESP_MAX - 1) len = BT_RESP_MAX - 1;
+  memcpy(resp, reply, len);
+  r = { -1, -1, -1 };
+  return btParseStatus(resp, len, &r);
+}
+
+static const char* reply(const char* body) {
+  static char buf[1024];
+  snprintf(buf, sizeof(buf),
+    "HTTP/1.0 200 OK\r\nContent-Type: application/json\r\nConnection: close\r\n\r\n%s", body);
+  return buf;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_normal_reply() {
+  TEST_ASSERT_NULL(parse(reply("{\"v\":12.634,\"i\":-1.25,\"p\":-15.8,\"state\":\"discharge\"}")));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 12.634f, r.v);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, -1.25f, r.i);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, -15.8f, r.p);
+}
+
+void test_whitespace_and_key_order() {
+  TEST_ASSERT_NULL(parse("HTTP/1.1 200 OK\r\n\r\n{ \"p\": 3.0 , \"i\": 0.25,\n \"v\": 12 }"));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 12.0f, r.v);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.25f, r.i);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 3.0f, r.p);
+}
+
+void test_non_200_status() {
+  TEST_ASSERT_EQUAL_STRING("status", parse("HTTP/1.0 404 Not Found\r\n\r\n{\"v\":1,\"i\":1,\"p\":1}"));
+  TEST_ASSERT_EQUAL_STRING("status", parse("HTTP/1.0 500 Internal Server Error\r\n\r\n"));
+  TEST_ASSERT_EQUAL_STRING("status", parse("ICY 200 OK\r\n\r\n{\"v\":1,\"i\":1,\"p\":1}"));
+  TEST_ASSERT_EQUAL_STRING("status", parse(""));
+  TEST_ASSERT_EQUAL_STRING("status", parse("HTTP/1.0"));
+  TEST_ASSERT_EQUAL(-1, r.v);       // reading untouched on failure
+}
+
+void test_missing_body_separator() {
+  TEST_ASSERT_EQUAL_STRING("status", parse("HTTP/1.0 200 OK\r\nContent-Type: application/json\r\n"));
+  TEST_ASSERT_EQUAL_STRING("status", parse("HTTP/1.0 200 OK\n\n{\"v\":1,\"i\":1,\"p\":1}"));
+}
+
+void test_reply_cut_off_at_buffer_size() {
+  // A long reply fills the buffer; whatever the cut, it must not parse
+  char big[2048];
+  char pad[1200];
+  memset(pad, 'x', sizeof(pad) - 1);
+  pad[sizeof(pad) - 1] = 0;
+  snprintf(big, sizeof(big), "HTTP/1.0 200 OK\r\nX-Pad: %s\r\n\r\n{\"v\":12.5,\"i\":1,\"p\":12}", pad);
+  TEST_ASSERT_EQUAL_STRING("truncated", parse(big));
+
+  // Exactly one byte short of the buffer still fits and parses
+  const char* body = "{\"v\":12.5,\"i\":1,\"p\":12}";
+  size_t head = strlen("HTTP/1.0 200 OK\r\nX-Pad: \r\n\r\n") + strlen(body);
+  snprintf(big, sizeof(big), "HTTP/1.0 200 OK\r\nX-Pad: %.*s\r\n\r\n%s",
+    (int)(BT_RESP_MAX - 2 - head), pad, body);
+  TEST_ASSERT_EQUAL(BT_RESP_MAX - 2, strlen(big));
+  TEST_ASSERT_NULL(parse(big));
+}
+
+void test_number_cut_off_mid_digits() {
+  TEST_ASSERT_EQUAL_STRING("parse", parse(reply("{\"v\":12.5,\"i\":1,\"p\":12")));
+}
+
+void test_nan_and_inf() {
+  TEST_ASSERT_EQUAL_STRING("parse", parse(reply("{\"v\":nan,\"i\":1,\"p\":1}")));
+  TEST_ASSERT_EQUAL_STRING("parse", parse(reply("{\"v\":12,\"i\":inf,\"p\":1}")));
+  TEST_ASSERT_EQUAL_STRING("parse", parse(reply("{\"v\":12,\"i\":1,\"p\":-INFINITY}")));
+  TEST_ASSERT_EQUAL_STRING("parse", parse(reply("{\"v\":1e39,\"i\":1,\"p\":1}")));   // overflows to inf
+}
+
+void test_implausible_values() {
+  TEST_ASSERT_EQUAL_STRING("parse", parse(reply("{\"v\":-0.5,\"i\":1,\"p\":1}")));
+  TEST_ASSERT_EQUAL_STRING("parse", parse(reply("{\"v\":100.1,\"i\":1,\"p\":1}")));
+  TEST_ASSERT_EQUAL_STRING("parse", parse(reply("{\"v\":12,\"i\":-50.5,\"p\":1}")));
+  TEST_ASSERT_EQUAL_STRING("parse", parse(reply("{\"v\":12,\"i\":1,\"p\":5000.5}")));
+  TEST_ASSERT_NULL(parse(reply("{\"v\":100,\"i\":-50,\"p\":-5000}")));   // limits inclusive
+}
+
+void test_missing_or_malformed_key() {
+  TEST_ASSERT_EQUAL_STRING("parse", parse(reply("{\"v\":12,\"i\":1}")));
+  TEST_ASSERT_EQUAL_STRING("parse", parse(reply("{\"v\":12,\"iv\":1,\"p\":1}")));
+  TEST_ASSERT_EQUAL_STRING("parse", parse(reply("{\"v\":\"12\",\"i\":1,\"p\":1}")));
+  TEST_ASSERT_EQUAL_STRING("parse", parse(reply("")));
+}
+
+void test_host_validation() {
+  TEST_ASSERT_TRUE(btValidHost("192.168.1.50", 40));
+  TEST_ASSERT_TRUE(btValidHost("bt-tester.local", 40));
+  TEST_ASSERT_TRUE(btValidHost("fe80::1", 40));
+  TEST_ASSERT_FALSE(btValidHost("", 40));
+  TEST_ASSERT_FALSE(btValidHost("host\r\nX-Evil: 1", 40));
+  TEST_ASSERT_FALSE(btValidHost("a\",\"x\":\"", 40));
+  TEST_ASSERT_FALSE(btValidHost("two words", 40));
+  TEST_ASSERT_FALSE(btValidHost("host/path", 40));
+  TEST_ASSERT_TRUE(btValidHost("123456789", 10));
+  TEST_ASSERT_FALSE(btValidHost("1234567890", 10));   // no room for the terminator
+}
+
+void test_port_validation() {
+  uint16_t port = 80;
+  TEST_ASSERT_TRUE(btParsePort("1", &port));
+  TEST_ASSERT_EQUAL(1, port);
+  TEST_ASSERT_TRUE(btParsePort("65535", &port));
+  TEST_ASSERT_EQUAL(65535, port);
+  port = 80;
+  TEST_ASSERT_FALSE(btParsePort("0", &port));
+  TEST_ASSERT_FALSE(btParsePort("65536", &port));
+  TEST_ASSERT_FALSE(btParsePort("-1", &port));
+  TEST_ASSERT_FALSE(btParsePort("", &port));
+  TEST_ASSERT_FALSE(btParsePort("80x", &port));
+  TEST_ASSERT_FALSE(btParsePort(" 80", &port));
+  TEST_ASSERT_FALSE(btParsePort("99999999999999999999", &port));
+  TEST_ASSERT_EQUAL(80, port);      // untouched on failure
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_normal_reply);
+  RUN_TEST(test_whitespace_and_key_order);
+  RUN_TEST(test_non_200_status);
+  RUN_TEST(test_missing_body_separator);
+  RUN_TEST(test_reply_cut_off_at_buffer_size);
+  RUN_TEST(test_number_cut_off_mid_digits);
+  RUN_TEST(test_nan_and_inf);
+  RUN_TEST(test_implausible_values);
+  RUN_TEST(test_missing_or_malformed_key);
+  RUN_TEST(test_host_validation);
+  RUN_TEST(test_port_validation);
+  return UNITY_END();
+}
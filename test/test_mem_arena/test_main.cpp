@@ -0,0 +1,187 @@
+// Native tests for mem_arena.h: arena/pool accounting, PSRAM fallback and
+// pointer checks in memPoolPut(), plus a soak run of the request pattern.
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "mem_arena.h"
+
+// Fake heaps: each kind can be switched off to force the fallback path
+static bool psramPresent;
+static bool internalPresent;
+static uint32_t rawAllocs;
+
+static void* testRawAlloc(size_t size, MemPlace place) {
+  if (place == MEM_PSRAM ? !psramPresent : !internalPresent) return nullptr;
+  rawAllocs++;
+  return malloc(size);
+}
+
+void setUp() {
+  psramPresent = internalPresent = true;
+  rawAllocs = 0;
+}
+
+void tearDown() {}
+
+void test_arena_alignment_and_high_water() {
+  MemArena a = { "t", MEM_PSRAM, 64 };
+  memArenaInit(a, testRawAlloc);
+  TEST_ASSERT_EQUAL(MEM_PSRAM, a.got);
+  uint8_t* p1 = (uint8_t*)memAlloc(a, 3, 1);
+  uint8_t* p2 = (uint8_t*)memAlloc(a, 8, 8);
+  TEST_ASSERT_EQUAL_PTR(a.base, p1);
+  TEST_ASSERT_EQUAL(0, (p2 - a.base) % 8);
+  TEST_ASSERT_EQUAL(16, a.used);
+  memReset(a);
+  TEST_ASSERT_EQUAL(0, a.used);
+  TEST_ASSERT_EQUAL(16, a.highWater);
+  free(a.base);
+}
+
+void test_arena_exhaustion_counts_fails() {
+  MemArena a = { "t", MEM_INTERNAL, 32 };
+  memArenaInit(a, testRawAlloc);
+  TEST_ASSERT_NOT_NULL(memAlloc(a, 32));
+  TEST_ASSERT_NULL(memAlloc(a, 1));
+  TEST_ASSERT_NULL(memAlloc(a, 1));
+  TEST_ASSERT_EQUAL(2, a.fails);
+  TEST_ASSERT_EQUAL(32, a.used);
+  free(a.base);
+}
+
+void test_psram_falls_back_to_internal() {
+  psramPresent = false;
+  MemArena a = { "t", MEM_PSRAM, 128 };
+  MemPool p = { "p", MEM_PSRAM, 64, 2 };
+  memArenaInit(a, testRawAlloc);
+  memPoolInit(p, testRawAlloc);
+  TEST_ASSERT_NOT_NULL(a.base);
+  TEST_ASSERT_EQUAL(MEM_INTERNAL, a.got);
+  TEST_ASSERT_NOT_NULL(p.base);
+  TEST_ASSERT_EQUAL(MEM_INTERNAL, p.got);
+  free(a.base);
+  free(p.base);
+}
+
+void test_no_memory_fails_every_request() {
+  psramPresent = internalPresent = false;
+  MemArena a = { "t", MEM_PSRAM, 128 };
+  MemPool p = { "p", MEM_INTERNAL, 64, 2 };
+  memArenaInit(a, testRawAlloc);
+  memPoolInit(p, testRawAlloc);
+  TEST_ASSERT_NULL(a.base);
+  TEST_ASSERT_NULL(memAlloc(a, 1));
+  TEST_ASSERT_EQUAL(1, a.fails);
+  TEST_ASSERT_NULL(memPoolGet(p));
+  TEST_ASSERT_EQUAL(1, p.fails);
+  TEST_ASSERT_EQUAL(0, p.inUse);
+}
+
+void test_pool_exhaustion_and_high_water() {
+  MemPool p = { "p", MEM_PSRAM, 16, 3 };
+  memPoolInit(p, testRawAlloc);
+  void* b[3];
+  for (int i = 0; i < 3; i++) b[i] = memPoolGet(p);
+  TEST_ASSERT_NULL(memPoolGet(p));
+  TEST_ASSERT_EQUAL(1, p.fails);
+  TEST_ASSERT_EQUAL(3, p.inUse);
+  TEST_ASSERT_EQUAL(3, p.highWater);
+  TEST_ASSERT_TRUE(memPoolPut(p, b[1]));
+  TEST_ASSERT_EQUAL_PTR(b[1], memPoolGet(p));   // freed slot is reused
+  for (int i = 0; i < 3; i++) TEST_ASSERT_TRUE(memPoolPut(p, b[i]));
+  TEST_ASSERT_EQUAL(0, p.inUse);
+  TEST_ASSERT_EQUAL(3, p.highWater);
+  free(p.base);
+}
+
+void test_pool_full_width_mask() {
+  MemPool p = { "p", MEM_INTERNAL, 4, MEM_POOL_MAX_BLOCKS };
+  memPoolInit(p, testRawAlloc);
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFu, p.freeMask);
+  for (int i = 0; i < MEM_POOL_MAX_BLOCKS; i++) TEST_ASSERT_NOT_NULL(memPoolGet(p));
+  TEST_ASSERT_NULL(memPoolGet(p));
+  free(p.base);
+
+  MemPool big = { "big", MEM_INTERNAL, 4, MEM_POOL_MAX_BLOCKS + 1 };
+  memPoolInit(big, testRawAlloc);
+  TEST_ASSERT_NULL(big.base);
+  TEST_ASSERT_NULL(memPoolGet(big));
+}
+
+void test_pool_put_rejects_bad_pointers() {
+  MemPool p = { "p", MEM_INTERNAL, 16, 2 };
+  memPoolInit(p, testRawAlloc);
+  uint8_t* b = (uint8_t*)memPoolGet(p);
+  uint8_t foreign[16];
+
+  TEST_ASSERT_TRUE(memPoolPut(p, nullptr));
+  TEST_ASSERT_FALSE(memPoolPut(p, foreign));
+  TEST_ASSERT_FALSE(memPoolPut(p, b + 1));               // not a block start
+  TEST_ASSERT_FALSE(memPoolPut(p, p.base + 2 * 16));     // one past the end
+  TEST_ASSERT_FALSE(memPoolPut(p, p.base + 16));         // never handed out
+  TEST_ASSERT_EQUAL(1, p.inUse);
+
+  TEST_ASSERT_TRUE(memPoolPut(p, b));
+  TEST_ASSERT_FALSE(memPoolPut(p, b));                   // double free
+  TEST_ASSERT_EQUAL(0, p.inUse);
+  TEST_ASSERT_EQUAL(5, p.badPuts);
+  TEST_ASSERT_EQUAL_UINT32(0x3, p.freeMask);
+  free(p.base);
+}
+
+// Soak: a day's worth of requests and log records must run entirely out of
+// the boot-time allocations, without touching the heap again.
+void test_soak_request_pattern() {
+  MemArena log = { "log", MEM_PSRAM, 2048 };
+  MemPool resp = { "resp", MEM_PSRAM, 16384, 2 };
+  memArenaInit(log, testRawAlloc);
+  memPoolInit(resp, testRawAlloc);
+  uint32_t bootAllocs = rawAllocs;
+
+  const uint32_t cycles = 2000000;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t c = 0; c < cycles; c++) {
+    void* r1 = memPoolGet(resp);
+    void* r2 = (c % 7 == 0) ? memPoolGet(resp) : nullptr;   // overlapping request
+    void* rec = memAlloc(log, 60 + c % 40, 1);
+    if (!rec) {
+      memReset(log);                                          // flush to SPIFFS
+      rec = memAlloc(log, 60 + c % 40, 1);
+    }
+    TEST_ASSERT_NOT_NULL(r1);
+    TEST_ASSERT_NOT_NULL(rec);
+    memPoolPut(resp, r2);
+    memPoolPut(resp, r1);
+  }
+  double ns = std::chrono::duration<double, std::nano>(
+    std::chrono::steady_clock::now() - t0).count() / cycles;
+
+  TEST_ASSERT_EQUAL(bootAllocs, rawAllocs);
+  TEST_ASSERT_EQUAL(0, resp.inUse);
+  TEST_ASSERT_EQUAL(2, resp.highWater);
+  TEST_ASSERT_EQUAL(0, resp.fails);
+  TEST_ASSERT_EQUAL(0, resp.badPuts);
+  TEST_ASSERT_LESS_OR_EQUAL(log.cap, log.highWater);
+
+  char msg[96];
+  snprintf(msg, sizeof(msg), "soak: %u cycles, %.1f ns/cycle, 0 heap calls after boot",
+    (unsigned)cycles, ns);
+  TEST_MESSAGE(msg);
+  free(log.base);
+  free(resp.base);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_arena_alignment_and_high_water);
+  RUN_TEST(test_arena_exhaustion_counts_fails);
+  RUN_TEST(test_psram_falls_back_to_internal);
+  RUN_TEST(test_no_memory_fails_every_request);
+  RUN_TEST(test_pool_exhaustion_and_high_water);
+  RUN_TEST(test_pool_full_width_mask);
+  RUN_TEST(test_pool_put_rejects_bad_pointers);
+  RUN_TEST(test_soak_request_pattern);
+  return UNITY_END();
+}
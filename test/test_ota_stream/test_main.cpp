@@ -0,0 +1,449 @@
+// Native tests for ota_stream.h: gzip and raw images fed in random slices,
+// dropped connections resumed from inOffset, optional gzip header fields,
+// truncated and corrupt streams, size/SHA mismatches and sink errors, and
+// the 32 KB window wrapping in the caller's buffer. zlib only produces the
+// test streams; decoding goes through the tinfl stand-in in test/support.
+// Set OTA_FIRMWARE_BIN to a real firmware.bin to report its gzip ratio.
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <zlib.h>
+
+#include "ota_stream.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+static OtaStream ota;
+static tinfl_decompressor* infl;
+static uint8_t* dict;
+static Bytes flash;               // what the sink received
+static size_t sinkFailAt;         // fail the write that crosses this offset
+
+static const char* testSink(const uint8_t* data, size_t n) {
+  if (flash.size() + n > sinkFailAt) return "ESP_ERR_FLASH_OP_FAIL";
+  flash.insert(flash.end(), data, data + n);
+  return nullptr;
+}
+
+void setUp() {
+  infl = (tinfl_decompressor*)calloc(1, sizeof(tinfl_decompressor));
+  dict = (uint8_t*)calloc(1, OTA_DICT_SIZE);
+  ota = OtaStream();
+  ota.sink = testSink;
+  ota.infl = infl;
+  ota.dict = dict;
+  flash.clear();
+  sinkFailAt = SIZE_MAX;
+}
+
+void tearDown() {
+  otaStreamEnd(ota);
+  free(infl);
+  free(dict);
+}
+
+static uint32_t rng = 1;
+static uint32_t rnd() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+// Firmware-like image: code-ish repeats at distances past the 32 KB
+// window, short literal runs and incompressible stretches
+static Bytes makeImage(size_t size) {
+  Bytes img(size);
+  for (size_t i = 0; i < size; i++) {
+    uint32_t r = rnd();
+    if (i > 40000 && (r & 3) == 0) img[i] = img[i - 40000 + (r >> 28)];
+    else if (i > 64 && (r & 3) == 1) img[i] = img[i - 17];
+    else if ((i / 4096) % 5 == 4) img[i] = (uint8_t)(r >> 8);
+    else img[i] = (uint8_t)((i * 7) ^ (r >> 29));
+  }
+  return img;
+}
+
+static void sha256(const Bytes& data, uint8_t out[32]) {
+  mbedtls_sha256_context c;
+  mbedtls_sha256_init(&c);
+  mbedtls_sha256_starts_ret(&c, 0);
+  mbedtls_sha256_update_ret(&c, data.data(), data.size());
+  mbedtls_sha256_finish_ret(&c, out);
+}
+
+// gzip -9 with whichever optional header fields are asked for
+static Bytes gzipImage(const Bytes& img, bool extra, bool name, bool comment, bool hcrc) {
+  z_stream z;
+  memset(&z, 0, sizeof(z));
+  deflateInit2(&z, 9, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY);
+  gz_header h;
+  memset(&h, 0, sizeof(h));
+  static uint8_t extraField[300];
+  for (size_t i = 0; i < sizeof(extraField); i++) extraField[i] = (uint8_t)(i * 31);
+  if (extra) { h.extra = extraField; h.extra_len = sizeof(extraField); }
+  if (name) h.name = (Bytef*)"firmware.bin";
+  if (comment) h.comment = (Bytef*)"lyrat-temp-thermal test image";
+  h.hcrc = hcrc;
+  deflateSetHeader(&z, &h);
+  Bytes out(deflateBound(&z, img.size()) + 1024);
+  z.next_in = (Bytef*)img.data();
+  z.avail_in = img.size();
+  z.next_out = out.data();
+  z.avail_out = out.size();
+  deflate(&z, Z_FINISH);
+  out.resize(z.total_out);
+  deflateEnd(&z);
+  return out;
+}
+
+static Bytes gzipImage(const Bytes& img) {
+  return gzipImage(img, false, false, false, false);
+}
+
+// Blocks of 30000 bytes that recur, so most of the stream is matches whose
+// source sits on the other side of the window's wrap point
+static Bytes makeRepeatingImage(size_t size) {
+  Bytes block(30000);
+  for (size_t i = 0; i < block.size(); i++) block[i] = (uint8_t)(rnd() >> 24);
+  Bytes img(size);
+  for (size_t i = 0; i < size; i++) {
+    img[i] = block[i % block.size()];
+    if (rnd() % 5000 == 0) img[i] ^= 0x5A;     // occasional literal
+  }
+  return img;
+}
+
+static bool begin(const Bytes& img, bool gzip) {
+  uint8_t sha[32];
+  sha256(img, sha);
+  return otaStreamBegin(ota, img.size(), sha, gzip);
+}
+
+// Feeds [from, to) in random slices of 1..maxSlice bytes
+static bool feedRandom(const Bytes& up, size_t from, size_t to, size_t maxSlice) {
+  while (from < to) {
+    size_t n = 1 + rnd() % maxSlice;
+    if (n > to - from) n = to - from;
+    if (!otaStreamFeed(ota, up.data() + from, n)) return false;
+    from += n;
+  }
+  return true;
+}
+
+void test_parse_sha() {
+  uint8_t sha[32];
+  TEST_ASSERT_TRUE(otaParseSha(
+    "BA7816BF8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", sha));
+  TEST_ASSERT_EQUAL(0xBA, sha[0]);
+  TEST_ASSERT_EQUAL(0x8F, sha[4]);
+  TEST_ASSERT_EQUAL(0xAD, sha[31]);
+  TEST_ASSERT_FALSE(otaParseSha(
+    "zz7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", sha));
+  TEST_ASSERT_FALSE(otaParseSha(
+    "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015a ", sha));
+  TEST_ASSERT_FALSE(otaParseSha(
+    "0xba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015", sha));
+  TEST_ASSERT_FALSE(otaParseSha("ba7816bf", sha));
+  TEST_ASSERT_FALSE(otaParseSha(
+    "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad00", sha));
+  TEST_ASSERT_FALSE(otaParseSha("", sha));
+}
+
+void test_sha256_vector() {
+  // FIPS 180-2 "abc"; checks the host SHA-256 the other cases rely on
+  Bytes abc = { 'a', 'b', 'c' };
+  uint8_t want[32], got[32];
+  otaParseSha("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", want);
+  sha256(abc, got);
+  TEST_ASSERT_EQUAL_MEMORY(want, got, 32);
+}
+
+void test_gzip_random_slices() {
+  Bytes img = makeImage(300000);
+  Bytes gz = gzipImage(img);
+  const size_t slices[] = { 1, 7, 512, 4096, 70000 };
+  for (size_t maxSlice : slices) {
+    tearDown();
+    setUp();
+    rng = 1000 + maxSlice;
+    TEST_ASSERT_TRUE(begin(img, true));
+    TEST_ASSERT_TRUE(feedRandom(gz, 0, gz.size(), maxSlice));
+    TEST_ASSERT_EQUAL(gz.size(), ota.inOffset);
+    TEST_ASSERT_TRUE(otaStreamFinish(ota));
+    TEST_ASSERT_EQUAL(img.size(), flash.size());
+    TEST_ASSERT_TRUE(flash == img);
+  }
+}
+
+void test_raw_random_slices() {
+  Bytes img = makeImage(100000);
+  TEST_ASSERT_TRUE(begin(img, false));
+  TEST_ASSERT_TRUE(feedRandom(img, 0, img.size(), 3000));
+  TEST_ASSERT_TRUE(otaStreamFinish(ota));
+  TEST_ASSERT_TRUE(flash == img);
+}
+
+// Each 64 KB request is cut off after a random part of its body arrived;
+// the client asks for the offset and resends from there
+void test_dropped_connections_resume() {
+  Bytes img = makeImage(400000);
+  Bytes gz = gzipImage(img);
+  TEST_ASSERT_TRUE(begin(img, true));
+  const size_t request = 65536;
+  int drops = 0;
+  while (ota.inOffset < gz.size()) {
+    size_t offset = ota.inOffset;
+    size_t end = offset + request < gz.size() ? offset + request : gz.size();
+    if (rnd() % 3 != 0) {
+      size_t cut = offset + rnd() % (end - offset);
+      TEST_ASSERT_TRUE(feedRandom(gz, offset, cut, 1460));
+      drops++;
+      continue;
+    }
+    TEST_ASSERT_TRUE(feedRandom(gz, offset, end, 1460));
+  }
+  TEST_ASSERT_GREATER_THAN(3, drops);
+  TEST_ASSERT_TRUE(otaStreamFinish(ota));
+  TEST_ASSERT_TRUE(flash == img);
+}
+
+void test_optional_header_fields() {
+  Bytes img = makeImage(50000);
+  for (int mask = 0; mask < 16; mask++) {
+    tearDown();
+    setUp();
+    Bytes gz = gzipImage(img, mask & 1, mask & 2, mask & 4, mask & 8);
+    TEST_ASSERT_EQUAL((mask & 1 ? 0x04 : 0) | (mask & 2 ? 0x08 : 0) |
+                      (mask & 4 ? 0x10 : 0) | (mask & 8 ? 0x02 : 0), gz[3]);
+    TEST_ASSERT_TRUE(begin(img, true));
+    // Byte by byte through the header, then larger slices
+    TEST_ASSERT_TRUE(feedRandom(gz, 0, 400, 1));
+    TEST_ASSERT_TRUE(feedRandom(gz, 400, gz.size(), 9000));
+    TEST_ASSERT_TRUE(otaStreamFinish(ota));
+    TEST_ASSERT_TRUE(flash == img);
+  }
+}
+
+void test_window_wraps() {
+  Bytes img = makeRepeatingImage(500000);
+  Bytes gz = gzipImage(img);
+  // Mostly back-references: the 30000-byte distance is within reach
+  TEST_ASSERT_LESS_THAN(img.size() / 8, gz.size());
+  const size_t slices[] = { 1, 1460, 65536 };
+  for (size_t maxSlice : slices) {
+    tearDown();
+    setUp();
+    TEST_ASSERT_TRUE(begin(img, true));
+    TEST_ASSERT_TRUE(feedRandom(gz, 0, gz.size(), maxSlice));
+    TEST_ASSERT_TRUE(otaStreamFinish(ota));
+    TEST_ASSERT_TRUE(flash == img);
+  }
+}
+
+// The inflater keeps no copy of the window: overwriting the caller's
+// buffer mid-stream must corrupt every later back-reference into it
+void test_window_belongs_to_caller() {
+  Bytes img = makeRepeatingImage(200000);
+  Bytes gz = gzipImage(img);
+  TEST_ASSERT_TRUE(begin(img, true));
+  TEST_ASSERT_TRUE(feedRandom(gz, 0, gz.size() / 2, 4096));
+  memset(dict, 0xA5, OTA_DICT_SIZE);
+  TEST_ASSERT_TRUE(feedRandom(gz, gz.size() / 2, gz.size(), 4096));
+  TEST_ASSERT_EQUAL(img.size(), flash.size());
+  TEST_ASSERT_FALSE(flash == img);
+  TEST_ASSERT_FALSE(otaStreamFinish(ota));
+  TEST_ASSERT_EQUAL_STRING("sha256 mismatch", ota.error);
+}
+
+// tinfl itself, driven the way otaInflate() does: each call may fill up
+// to the end of the window, HAS_MORE_OUTPUT only there, and on DONE the
+// unread trailer bytes are handed back
+void test_tinfl_window_contract() {
+  Bytes img = makeRepeatingImage(150000);
+  Bytes gz = gzipImage(img);
+  const uint8_t* in = gz.data() + 10;             // plain 10-byte header
+  size_t inLeft = gz.size() - 10;
+  Bytes out;
+  size_t pos = 0;
+  int fullWindows = 0;
+  tinfl_init(infl);
+  for (;;) {
+    size_t inBytes = inLeft < 999 ? inLeft : 999;
+    size_t outBytes = OTA_DICT_SIZE - pos;
+    tinfl_status st = tinfl_decompress(infl, in, &inBytes, dict, dict + pos, &outBytes,
+                                       TINFL_FLAG_HAS_MORE_INPUT);
+    out.insert(out.end(), dict + pos, dict + pos + outBytes);
+    in += inBytes;
+    inLeft -= inBytes;
+    if (st == TINFL_STATUS_HAS_MORE_OUTPUT) {
+      TEST_ASSERT_EQUAL(OTA_DICT_SIZE, pos + outBytes);
+      fullWindows++;
+    }
+    pos = (pos + outBytes) & (OTA_DICT_SIZE - 1);
+    if (st == TINFL_STATUS_DONE) break;
+    TEST_ASSERT_TRUE(st == TINFL_STATUS_HAS_MORE_OUTPUT || st == TINFL_STATUS_NEEDS_MORE_INPUT);
+    TEST_ASSERT_TRUE(st != TINFL_STATUS_NEEDS_MORE_INPUT || inLeft > 0);
+  }
+  TEST_ASSERT_TRUE(out == img);
+  TEST_ASSERT_GREATER_OR_EQUAL((int)(img.size() / OTA_DICT_SIZE) - 1, fullWindows);
+  TEST_ASSERT_EQUAL(8, inLeft);                   // CRC32 + ISIZE untouched
+
+  // DONE is sticky
+  size_t inBytes = inLeft;
+  size_t outBytes = OTA_DICT_SIZE - pos;
+  tinfl_status done = tinfl_decompress(infl, in, &inBytes, dict, dict + pos, &outBytes,
+                                       TINFL_FLAG_HAS_MORE_INPUT);
+  TEST_ASSERT_EQUAL(TINFL_STATUS_DONE, done);
+  TEST_ASSERT_EQUAL(0, inBytes);
+  TEST_ASSERT_EQUAL(0, outBytes);
+
+  // Output space that does not end on a power-of-two window is refused
+  tinfl_init(infl);
+  inBytes = 100;
+  outBytes = 1000;
+  tinfl_status st = tinfl_decompress(infl, gz.data() + 10, &inBytes, dict, dict + 100, &outBytes,
+                                     TINFL_FLAG_HAS_MORE_INPUT);
+  TEST_ASSERT_EQUAL(TINFL_STATUS_BAD_PARAM, st);
+  TEST_ASSERT_EQUAL(0, inBytes);
+  TEST_ASSERT_EQUAL(0, outBytes);
+}
+
+void test_not_gzip() {
+  Bytes img = makeImage(1000);
+  TEST_ASSERT_TRUE(begin(img, true));
+  TEST_ASSERT_FALSE(otaStreamFeed(ota, img.data(), img.size()));
+  TEST_ASSERT_EQUAL_STRING("not a gzip stream", ota.error);
+  TEST_ASSERT_EQUAL(0, ota.inOffset);
+  TEST_ASSERT_FALSE(otaStreamFinish(ota));
+}
+
+void test_truncated_streams() {
+  Bytes img = makeImage(120000);
+  Bytes gz = gzipImage(img, true, true, true, true);
+  const size_t cuts[] = { 0, 5, 12, 200, 340, gz.size() / 3, gz.size() - 9 };
+  for (size_t cut : cuts) {
+    tearDown();
+    setUp();
+    TEST_ASSERT_TRUE(begin(img, true));
+    TEST_ASSERT_TRUE(feedRandom(gz, 0, cut, 777));
+    TEST_ASSERT_FALSE(otaStreamFinish(ota));
+    TEST_ASSERT_EQUAL_STRING("compressed stream incomplete", ota.error);
+  }
+  // Only the 8-byte trailer missing: the image itself is complete
+  tearDown();
+  setUp();
+  TEST_ASSERT_TRUE(begin(img, true));
+  TEST_ASSERT_TRUE(feedRandom(gz, 0, gz.size() - 8, 777));
+  TEST_ASSERT_TRUE(otaStreamFinish(ota));
+}
+
+void test_truncated_raw_image() {
+  Bytes img = makeImage(10000);
+  TEST_ASSERT_TRUE(begin(img, false));
+  TEST_ASSERT_TRUE(feedRandom(img, 0, img.size() - 1, 500));
+  TEST_ASSERT_FALSE(otaStreamFinish(ota));
+  TEST_ASSERT_EQUAL_STRING("image shorter than announced", ota.error);
+}
+
+void test_corrupt_deflate() {
+  Bytes img = makeImage(60000);
+  Bytes gz = gzipImage(img);
+  gz[10] = 0xFF;        // first deflate block header: reserved block type
+  TEST_ASSERT_TRUE(begin(img, true));
+  TEST_ASSERT_FALSE(feedRandom(gz, 0, gz.size(), 4096));
+  TEST_ASSERT_EQUAL_STRING("corrupt deflate stream", ota.error);
+}
+
+void test_sha_mismatch() {
+  Bytes img = makeImage(80000);
+  Bytes gz = gzipImage(img);
+  uint8_t sha[32];
+  sha256(img, sha);
+  sha[31] ^= 1;
+  TEST_ASSERT_TRUE(otaStreamBegin(ota, img.size(), sha, true));
+  TEST_ASSERT_TRUE(feedRandom(gz, 0, gz.size(), 5000));
+  TEST_ASSERT_FALSE(otaStreamFinish(ota));
+  TEST_ASSERT_EQUAL_STRING("sha256 mismatch", ota.error);
+}
+
+void test_image_larger_than_announced() {
+  Bytes img = makeImage(80000);
+  Bytes gz = gzipImage(img);
+  uint8_t sha[32];
+  sha256(img, sha);
+  TEST_ASSERT_TRUE(otaStreamBegin(ota, img.size() - 100, sha, true));
+  TEST_ASSERT_FALSE(feedRandom(gz, 0, gz.size(), 5000));
+  TEST_ASSERT_EQUAL_STRING("image larger than announced", ota.error);
+  TEST_ASSERT_LESS_OR_EQUAL(img.size() - 100, flash.size());
+}
+
+void test_sink_error_stops_stream() {
+  Bytes img = makeImage(80000);
+  Bytes gz = gzipImage(img);
+  sinkFailAt = 50000;
+  TEST_ASSERT_TRUE(begin(img, true));
+  TEST_ASSERT_FALSE(feedRandom(gz, 0, gz.size(), 5000));
+  TEST_ASSERT_EQUAL_STRING("ESP_ERR_FLASH_OP_FAIL", ota.error);
+  size_t stoppedAt = ota.inOffset;
+  TEST_ASSERT_FALSE(otaStreamFeed(ota, gz.data() + stoppedAt, 1));
+  TEST_ASSERT_EQUAL(stoppedAt, ota.inOffset);
+}
+
+void test_gzip_needs_inflate_buffers() {
+  ota.dict = nullptr;
+  Bytes img = makeImage(100);
+  TEST_ASSERT_FALSE(begin(img, true));
+  TEST_ASSERT_EQUAL_STRING("no inflate buffer, use enc=raw", ota.error);
+  TEST_ASSERT_TRUE(begin(img, false));
+}
+
+// Compressed/raw ratio and a full pipeline run for a real build output
+void test_firmware_ratio() {
+  const char* path = getenv("OTA_FIRMWARE_BIN");
+  if (!path) path = ".pio/build/esp32-lyrat/firmware.bin";
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    TEST_IGNORE_MESSAGE("no firmware.bin (build esp32-lyrat or set OTA_FIRMWARE_BIN)");
+  }
+  Bytes img;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) img.insert(img.end(), buf, buf + n);
+  fclose(f);
+  Bytes gz = gzipImage(img);
+  TEST_ASSERT_TRUE(begin(img, true));
+  TEST_ASSERT_TRUE(feedRandom(gz, 0, gz.size(), 65536));
+  TEST_ASSERT_TRUE(otaStreamFinish(ota));
+  TEST_ASSERT_TRUE(flash == img);
+
+  char msg[160];
+  snprintf(msg, sizeof(msg), "%s: %u -> %u bytes gzip -9, ratio %.3f (%.0f%% less to send)",
+    path, (unsigned)img.size(), (unsigned)gz.size(), (double)gz.size() / img.size(),
+    100.0 * (1 - (double)gz.size() / img.size()));
+  TEST_MESSAGE(msg);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_parse_sha);
+  RUN_TEST(test_sha256_vector);
+  RUN_TEST(test_gzip_random_slices);
+  RUN_TEST(test_raw_random_slices);
+  RUN_TEST(test_dropped_connections_resume);
+  RUN_TEST(test_optional_header_fields);
+  RUN_TEST(test_window_wraps);
+  RUN_TEST(test_window_belongs_to_caller);
+  RUN_TEST(test_tinfl_window_contract);
+  RUN_TEST(test_not_gzip);
+  RUN_TEST(test_truncated_streams);
+  RUN_TEST(test_truncated_raw_image);
+  RUN_TEST(test_corrupt_deflate);
+  RUN_TEST(test_sha_mismatch);
+  RUN_TEST(test_image_larger_than_announced);
+  RUN_TEST(test_sink_error_stops_stream);
+  RUN_TEST(test_gzip_needs_inflate_buffers);
+  RUN_TEST(test_firmware_ratio);
+  return UNITY_END();
+}
@@ -0,0 +1,197 @@
+// Native tests for sample_bus.h: ordering, lapping and drop accounting,
+// the per-source view, a multi-reader stress run against a live producer
+// and publish/read throughput.
+#include <unity.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "sample_bus.h"
+
+static SampleBus bus;
+
+void setUp() {
+  bus.head.store(0);
+  for (BusSlot& s : bus.slots) s.stamp.store(0);
+}
+
+void tearDown() {}
+
+// Every field derives from the position, so a torn sample is detectable
+static void publishAt(uint32_t pos) {
+  busPublish(bus, pos % SRC_COUNT, (float)(pos & 0xFFFF), pos & 1 ? SQ_PARTIAL : SQ_OK,
+    (int64_t)pos * 3 + 1);
+}
+
+static bool consistent(const Sample& s) {
+  return s.tUs == (int64_t)s.seq * 3 + 1 && s.src == s.seq % SRC_COUNT &&
+         s.value == (float)(s.seq & 0xFFFF) && s.flags == (s.seq & 1 ? SQ_PARTIAL : SQ_OK);
+}
+
+void test_reads_in_order() {
+  BusReader r = { "r" };
+  for (uint32_t i = 0; i < 10; i++) publishAt(i);
+  Sample s;
+  for (uint32_t i = 0; i < 10; i++) {
+    TEST_ASSERT_TRUE(busRead(bus, r, &s));
+    TEST_ASSERT_EQUAL(i, s.seq);
+    TEST_ASSERT_TRUE(consistent(s));
+  }
+  TEST_ASSERT_FALSE(busRead(bus, r, &s));
+  TEST_ASSERT_EQUAL(0, r.dropped);
+}
+
+void test_lapped_reader_counts_drops() {
+  BusReader r = { "r" };
+  for (uint32_t i = 0; i < 100; i++) publishAt(i);
+  Sample s;
+  uint32_t got = 0;
+  uint32_t first = UINT32_MAX;
+  while (busRead(bus, r, &s)) {
+    if (first == UINT32_MAX) first = s.seq;
+    TEST_ASSERT_TRUE(consistent(s));
+    got++;
+  }
+  TEST_ASSERT_EQUAL(BUS_SLOTS, got);
+  TEST_ASSERT_EQUAL(100 - BUS_SLOTS, first);
+  TEST_ASSERT_EQUAL(100 - BUS_SLOTS, r.dropped);
+}
+
+void test_drain_keeps_latest_and_skips_rejected() {
+  BusReader r = { "r" };
+  busPublish(bus, SRC_DS1, 21.5f, SQ_OK, 1000);
+  busPublish(bus, SRC_DS1, 85.0f, SQ_REJECTED, 2000);
+  busPublish(bus, SRC_BT_V, 12.6f, SQ_OK, 3000);
+  busPublish(bus, SRC_BT_V, 12.5f, SQ_OK, 4000);
+  busDrain(bus, r);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 21.5f, busValue(r, SRC_DS1, -127));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 12.5f, busValue(r, SRC_BT_V, 0));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, -127.0f, busValue(r, SRC_DS2, -127));
+  TEST_ASSERT_EQUAL(5, busAgeMs(r, SRC_DS1, 6000));
+  TEST_ASSERT_EQUAL(ULONG_MAX, busAgeMs(r, SRC_DS2, 6000));
+}
+
+void test_forget_until_republished() {
+  BusReader r = { "r" };
+  busPublish(bus, SRC_BT_V, 12.6f, SQ_OK, 1000);
+  busPublish(bus, SRC_DS1, 20.0f, SQ_OK, 1000);
+  busDrain(bus, r);
+  busForget(r, SRC_BT_V);
+  TEST_ASSERT_FALSE(r.have[SRC_BT_V]);
+  TEST_ASSERT_EQUAL(ULONG_MAX, busAgeMs(r, SRC_BT_V, 5000));
+  TEST_ASSERT_TRUE(r.have[SRC_DS1]);
+  busDrain(bus, r);                      // nothing new: stays forgotten
+  TEST_ASSERT_FALSE(r.have[SRC_BT_V]);
+  busPublish(bus, SRC_BT_V, 3.7f, SQ_OK, 2000);
+  busDrain(bus, r);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 3.7f, busValue(r, SRC_BT_V, 0));
+}
+
+void test_sequence_wraps() {
+  BusReader r = { "r" };
+  bus.head.store(UINT32_MAX - 2);
+  r.next = UINT32_MAX - 2;
+  for (uint32_t i = 0; i < 6; i++) publishAt(UINT32_MAX - 2 + i);
+  Sample s;
+  uint32_t got = 0;
+  while (busRead(bus, r, &s)) {
+    TEST_ASSERT_EQUAL((uint32_t)(UINT32_MAX - 2 + got), s.seq);
+    got++;
+  }
+  TEST_ASSERT_EQUAL(6, got);
+  TEST_ASSERT_EQUAL(0, r.dropped);
+}
+
+// One producer, several readers polling as fast as they can. Readers must
+// never return a torn or out-of-order sample, and every position must be
+// accounted for exactly once as either read or dropped.
+struct StressResult {
+  uint64_t got;
+  uint64_t bad;
+  uint32_t dropped;
+};
+
+void test_concurrent_readers_stress() {
+  const uint32_t total = 2000000;
+  const int readers = 3;
+  std::atomic<bool> done(false);
+  std::atomic<int> started(0);
+  std::vector<StressResult> res(readers);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < readers; t++) {
+    threads.emplace_back([&, t]() {
+      BusReader r = { "stress" };
+      StressResult out = { 0, 0, 0 };
+      uint32_t last = 0;
+      bool any = false;
+      Sample s;
+      started.fetch_add(1);
+      for (;;) {
+        bool finished = done.load(std::memory_order_acquire);
+        while (busRead(bus, r, &s)) {
+          if (!consistent(s) || (any && s.seq <= last)) out.bad++;
+          last = s.seq;
+          any = true;
+          out.got++;
+        }
+        if (finished) break;
+        std::this_thread::yield();
+      }
+      out.dropped = r.dropped;
+      res[t] = out;
+    });
+  }
+  while (started.load() < readers) std::this_thread::yield();
+  for (uint32_t i = 0; i < total; i++) {
+    publishAt(i);
+    if ((i & 255) == 255) std::this_thread::yield();   // let readers keep partly up
+  }
+  done.store(true, std::memory_order_release);
+  for (std::thread& th : threads) th.join();
+
+  for (int t = 0; t < readers; t++) {
+    TEST_ASSERT_EQUAL(0, res[t].bad);
+    TEST_ASSERT_GREATER_THAN(0, res[t].got);
+    TEST_ASSERT_EQUAL(total, res[t].got + res[t].dropped);
+    char msg[96];
+    snprintf(msg, sizeof(msg), "stress reader %d: %llu read, %u dropped", t,
+      (unsigned long long)res[t].got, res[t].dropped);
+    TEST_MESSAGE(msg);
+  }
+}
+
+// Throughput in the firmware's pattern: the loop task publishes a handful of
+// samples per pass and the log/web readers drain on the same core
+void test_throughput() {
+  const uint32_t passes = 2000000;
+  BusReader r = { "bench" };
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < passes; i++) {
+    publishAt(i);
+    if ((i & 7) == 7) busDrain(bus, r);
+  }
+  busDrain(bus, r);
+  double ns = std::chrono::duration<double, std::nano>(
+    std::chrono::steady_clock::now() - t0).count() / passes;
+  TEST_ASSERT_EQUAL(0, r.dropped);
+  TEST_ASSERT_EQUAL(passes, r.next);
+
+  char msg[96];
+  snprintf(msg, sizeof(msg), "throughput: %.1f ns per publish+read (%.1f M samples/s)",
+    ns, 1000.0 / ns);
+  TEST_MESSAGE(msg);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_reads_in_order);
+  RUN_TEST(test_lapped_reader_counts_drops);
+  RUN_TEST(test_drain_keeps_latest_and_skips_rejected);
+  RUN_TEST(test_forget_until_republished);
+  RUN_TEST(test_sequence_wraps);
+  RUN_TEST(test_concurrent_readers_stress);
+  RUN_TEST(test_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,226 @@
+// Native tests for scheduler.h on a simulated clock: batch priority order,
+// one-shots, lateness measured per job, overload, LATE_SKIP vs LATE_BURST
+// catch-up and ms wraparound.
+#include <unity.h>
+#include <stdio.h>
+
+#include "scheduler.h"
+
+static int64_t simUs;
+static int64_t simClock() { return simUs; }
+static void simAdvanceMs(uint32_t ms) { simUs += (int64_t)ms * 1000; }
+
+static Scheduler sched;
+
+// Jobs record their run order and may burn simulated time
+static char order[64];
+static int orderLen;
+static uint32_t costA, costB, costC;
+
+static void record(char c) {
+  if (orderLen < (int)sizeof(order) - 1) order[orderLen++] = c;
+}
+
+static void jobA() { record('A'); simAdvanceMs(costA); }
+static void jobB() { record('B'); simAdvanceMs(costB); }
+static void jobC() { record('C'); simAdvanceMs(costC); }
+
+void setUp() {
+  sched = Scheduler();
+  sched.clockUs = simClock;
+  simUs = 1000 * 1000;
+  orderLen = 0;
+  order[0] = 0;
+  costA = costB = costC = 0;
+}
+
+void tearDown() {}
+
+// loop() in miniature: run what is due, then sleep until the next due time
+static void simLoopUntilMs(uint32_t endMs) {
+  while (schedBefore(schedNowMs(sched), endMs)) {
+    schedRun(sched);
+    uint32_t wait = schedNextDueIn(sched);
+    if (wait > SCHED_IDLE_MAX_MS) wait = SCHED_IDLE_MAX_MS;
+    simAdvanceMs(wait ? wait : 1);
+  }
+  order[orderLen] = 0;
+}
+
+void test_due_jobs_run_in_priority_order() {
+  int a = schedAdd(sched, "a", jobA, 100, 50, 3, LATE_SKIP);
+  int b = schedAdd(sched, "b", jobB, 100, 50, 1, LATE_SKIP);
+  int c = schedAdd(sched, "c", jobC, 100, 50, 2, LATE_SKIP);
+  uint32_t now = schedNowMs(sched);
+  schedArm(sched, a, now);
+  schedArm(sched, b, now);
+  schedArm(sched, c, now);
+  schedRun(sched);
+  order[orderLen] = 0;
+  TEST_ASSERT_EQUAL_STRING("BCA", order);
+  TEST_ASSERT_EQUAL(100, schedNextDueIn(sched));
+}
+
+void test_not_due_does_not_run() {
+  int a = schedAdd(sched, "a", jobA, 100, 50, 1, LATE_SKIP);
+  schedArm(sched, a, schedNowMs(sched) + 5);
+  schedRun(sched);
+  TEST_ASSERT_EQUAL(0, orderLen);
+  TEST_ASSERT_EQUAL(5, schedNextDueIn(sched));
+  simAdvanceMs(5);
+  schedRun(sched);
+  TEST_ASSERT_EQUAL(1, orderLen);
+}
+
+void test_one_shot_runs_once() {
+  int a = schedAdd(sched, "a", jobA, 0, 50, 1, LATE_SKIP);
+  schedArm(sched, a, schedNowMs(sched) + 10);
+  simLoopUntilMs(schedNowMs(sched) + 1000);
+  TEST_ASSERT_EQUAL_STRING("A", order);
+  TEST_ASSERT_EQUAL(UINT32_MAX, schedNextDueIn(sched));
+  TEST_ASSERT_EQUAL(-1, sched.jobs[a].heapPos);
+}
+
+void test_table_full() {
+  for (int i = 0; i < SCHED_MAX_JOBS; i++) {
+    TEST_ASSERT_EQUAL(i, schedAdd(sched, "x", jobA, 100, 50, 1, LATE_SKIP));
+  }
+  TEST_ASSERT_EQUAL(-1, schedAdd(sched, "x", jobA, 100, 50, 1, LATE_SKIP));
+}
+
+// Lateness is taken when each job actually starts, so a slow job earlier
+// in the batch makes the ones after it late
+void test_lateness_uses_start_time_within_batch() {
+  costA = 30;
+  int a = schedAdd(sched, "a", jobA, 1000, 50, 1, LATE_SKIP);
+  int b = schedAdd(sched, "b", jobB, 1000, 20, 2, LATE_SKIP);
+  uint32_t now = schedNowMs(sched);
+  schedArm(sched, a, now);
+  schedArm(sched, b, now);
+  schedRun(sched);
+  TEST_ASSERT_EQUAL(0, sched.jobs[a].missed);
+  TEST_ASSERT_EQUAL(0, sched.jobs[a].maxLateMs);
+  TEST_ASSERT_EQUAL(30000, sched.jobs[a].maxRunUs);
+  TEST_ASSERT_EQUAL(1, sched.jobs[b].missed);
+  TEST_ASSERT_EQUAL(30, sched.jobs[b].maxLateMs);
+}
+
+// A one-time stall of 950 ms on a 100 ms job
+static void stallThenRun(LatePolicy late, int* id) {
+  *id = schedAdd(sched, "a", jobA, 100, 20, 1, late);
+  uint32_t t0 = schedNowMs(sched);
+  schedArm(sched, *id, t0);
+  schedRun(sched);                       // runs at t0, next due t0 + 100
+  simAdvanceMs(1050);                    // e.g. a blocking SPIFFS write
+  simLoopUntilMs(t0 + 1250);
+}
+
+void test_late_skip_stays_phase_locked() {
+  int a;
+  uint32_t t0 = schedNowMs(sched);
+  stallThenRun(LATE_SKIP, &a);
+  Job& j = sched.jobs[a];
+  // t0, the late run at t0+1050, then t0+1100 and t0+1200
+  TEST_ASSERT_EQUAL(4, j.runs);
+  TEST_ASSERT_EQUAL(9, j.skipped);
+  TEST_ASSERT_EQUAL(1, j.missed);
+  TEST_ASSERT_EQUAL(950, j.maxLateMs);
+  TEST_ASSERT_EQUAL(t0 + 1300, j.due);
+}
+
+void test_late_burst_catches_up_bounded() {
+  int a;
+  uint32_t t0 = schedNowMs(sched);
+  stallThenRun(LATE_BURST, &a);
+  Job& j = sched.jobs[a];
+  // The late run, then SCHED_MAX_BURST back-to-back catch-up runs for
+  // t0+800..1000 before settling at t0+1100 and t0+1200
+  TEST_ASSERT_EQUAL(1 + 1 + SCHED_MAX_BURST + 2, j.runs);
+  TEST_ASSERT_EQUAL(9 - SCHED_MAX_BURST, j.skipped);
+  TEST_ASSERT_EQUAL(1 + SCHED_MAX_BURST, j.missed);
+  TEST_ASSERT_EQUAL(t0 + 1300, j.due);
+}
+
+// Overload: a 100 ms job that takes 150 ms to run. Re-arming uses the
+// clock after the run, so the job settles at every other period instead
+// of spinning, and the cheap job still gets its turns.
+void test_overload() {
+  costA = 150;
+  costB = 1;
+  int a = schedAdd(sched, "a", jobA, 100, 20, 1, LATE_SKIP);
+  int b = schedAdd(sched, "b", jobB, 50, 20, 2, LATE_SKIP);
+  uint32_t t0 = schedNowMs(sched);
+  schedArm(sched, a, t0);
+  schedArm(sched, b, t0);
+  simLoopUntilMs(t0 + 10000);
+  Job& ja = sched.jobs[a];
+  Job& jb = sched.jobs[b];
+  TEST_ASSERT_EQUAL(50, ja.runs);        // every 200 ms
+  TEST_ASSERT_EQUAL(50, ja.skipped);
+  TEST_ASSERT_EQUAL(0, ja.missed);       // phase-locked, always starts on time
+  TEST_ASSERT_EQUAL(150000, ja.maxRunUs);
+  TEST_ASSERT_GREATER_THAN(0, jb.missed);
+  TEST_ASSERT_LESS_OR_EQUAL(150, jb.maxLateMs);
+  TEST_ASSERT_EQUAL(10000 / 50 - jb.skipped, jb.runs);
+
+  char msg[128];
+  snprintf(msg, sizeof(msg), "overload 10 s: a runs %u skipped %u, b runs %u skipped %u missed %u maxLate %u ms",
+    ja.runs, ja.skipped, jb.runs, jb.skipped, jb.missed, jb.maxLateMs);
+  TEST_MESSAGE(msg);
+}
+
+void test_overload_burst_is_bounded() {
+  costA = 150;
+  int a = schedAdd(sched, "a", jobA, 100, 20, 1, LATE_BURST);
+  uint32_t t0 = schedNowMs(sched);
+  schedArm(sched, a, t0);
+  simLoopUntilMs(t0 + 10000);
+  Job& j = sched.jobs[a];
+  // Never more than SCHED_MAX_BURST periods behind, so it runs flat out
+  // and every run after the first is late
+  TEST_ASSERT_GREATER_THAN(60, j.runs);
+  TEST_ASSERT_EQUAL(j.runs - 1, j.missed);
+  TEST_ASSERT_LESS_OR_EQUAL((SCHED_MAX_BURST + 1) * 100, j.maxLateMs);
+}
+
+// A job re-arming itself (btPoll, one-shots) is not re-armed again
+static int selfId;
+static void selfArm() {
+  record('S');
+  schedArm(sched, selfId, schedNowMs(sched) + 7);
+}
+
+void test_self_rearm_wins() {
+  selfId = schedAdd(sched, "s", selfArm, 100, 50, 1, LATE_SKIP);
+  uint32_t t0 = schedNowMs(sched);
+  schedArm(sched, selfId, t0);
+  schedRun(sched);
+  TEST_ASSERT_EQUAL(t0 + 7, sched.jobs[selfId].due);
+}
+
+void test_ms_wraparound() {
+  simUs = ((int64_t)UINT32_MAX - 250) * 1000;
+  int a = schedAdd(sched, "a", jobA, 100, 20, 1, LATE_SKIP);
+  uint32_t t0 = schedNowMs(sched);
+  schedArm(sched, a, t0);
+  simLoopUntilMs(t0 + 1000);
+  TEST_ASSERT_EQUAL(10, sched.jobs[a].runs);
+  TEST_ASSERT_EQUAL(0, sched.jobs[a].missed);
+  TEST_ASSERT_EQUAL(0, sched.jobs[a].skipped);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_due_jobs_run_in_priority_order);
+  RUN_TEST(test_not_due_does_not_run);
+  RUN_TEST(test_one_shot_runs_once);
+  RUN_TEST(test_table_full);
+  RUN_TEST(test_lateness_uses_start_time_within_batch);
+  RUN_TEST(test_late_skip_stays_phase_locked);
+  RUN_TEST(test_late_burst_catches_up_bounded);
+  RUN_TEST(test_overload);
+  RUN_TEST(test_overload_burst_is_bounded);
+  RUN_TEST(test_self_rearm_wins);
+  RUN_TEST(test_ms_wraparound);
+  return UNITY_END();
+}
@@ -0,0 +1,185 @@
+// Native tests for session_maps.h: arena sizing, max-hold timestamps,
+// time-above accumulation, mean and reset semantics, plus a timing run of
+// the 768-pixel update as mlxRead() does it.
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+
+#include "session_maps.h"
+
+#define PIXELS 768
+
+static void* testRawAlloc(size_t size, MemPlace) {
+  return malloc(size);
+}
+
+static MemArena arena;
+static SessionMaps maps;
+
+static void initMaps(size_t arenaBytes, int pixels) {
+  arena = { "maps", MEM_PSRAM, arenaBytes };
+  memArenaInit(arena, testRawAlloc);
+  maps = SessionMaps();
+  mapInit(maps, arena, pixels, 1000);
+}
+
+void setUp() {
+  initMaps(MAP_ARENA_BYTES(PIXELS), PIXELS);
+}
+
+void tearDown() {
+  free(arena.base);
+}
+
+// One frame at nowMs with pixel i set to temps[i] (nan = invalid pixel)
+static void frame(uint32_t nowMs, const float* temps, int n) {
+  mapBeginFrame(maps, nowMs);
+  for (int i = 0; i < n; i++) {
+    if (temps[i] == temps[i]) mapAccumulate(maps, i, temps[i]);
+  }
+}
+
+void test_arena_holds_all_arrays() {
+  TEST_ASSERT_TRUE(maps.ready);
+  TEST_ASSERT_EQUAL(22, MAP_BYTES_PER_PIXEL);
+  TEST_ASSERT_EQUAL(0, arena.fails);
+  TEST_ASSERT_LESS_OR_EQUAL(arena.cap, arena.used);
+}
+
+void test_old_16k_arena_is_too_small() {
+  free(arena.base);
+  initMaps(16384, PIXELS);
+  TEST_ASSERT_FALSE(maps.ready);
+  TEST_ASSERT_GREATER_THAN(0, arena.fails);
+}
+
+void test_odd_pixel_counts_fit() {
+  for (int pixels = 1; pixels <= 9; pixels++) {
+    free(arena.base);
+    initMaps(MAP_ARENA_BYTES(pixels), pixels);
+    TEST_ASSERT_TRUE(maps.ready);
+  }
+}
+
+void test_max_hold_keeps_first_time_of_max() {
+  float t[2];
+  t[0] = 20.0f; t[1] = 50.0f; frame(1000, t, 2);
+  t[0] = 30.0f; t[1] = 40.0f; frame(1100, t, 2);
+  t[0] = 25.0f; t[1] = 50.0f; frame(1250, t, 2);   // equal, not a new max
+  t[0] = 30.0f; t[1] = 49.0f; frame(1400, t, 2);
+  TEST_ASSERT_EQUAL_INT16(3000, maps.maxCc[0]);
+  TEST_ASSERT_EQUAL(100, maps.maxAtMs[0]);
+  TEST_ASSERT_EQUAL_INT16(5000, maps.maxCc[1]);
+  TEST_ASSERT_EQUAL(0, maps.maxAtMs[1]);
+}
+
+void test_time_above_sums_frame_intervals() {
+  // thr 45 C; intervals 100, 150, 200, 50 ms
+  const float seq[] = { 50.0f, 50.0f, 40.0f, 50.0f, 45.0f };
+  const uint32_t at[] = { 1000, 1100, 1250, 1450, 1500 };
+  for (int k = 0; k < 5; k++) frame(at[k], &seq[k], 1);
+  // first frame has no interval; 40 C and exactly 45 C are not above
+  TEST_ASSERT_EQUAL(100 + 200, maps.aboveMs[0]);
+  TEST_ASSERT_EQUAL(5, maps.frames);
+}
+
+void test_threshold_is_configurable() {
+  maps.thrCc = 3000;
+  const float t = 35.0f;
+  frame(1000, &t, 1);
+  frame(1500, &t, 1);
+  frame(2500, &t, 1);
+  TEST_ASSERT_EQUAL(1500, maps.aboveMs[0]);
+}
+
+void test_mean_and_rounding() {
+  float t[3] = { 20.0f, -0.004f, NAN };
+  frame(1000, t, 3);
+  t[0] = 21.01f; t[1] = -0.006f;
+  frame(1100, t, 3);
+  TEST_ASSERT_EQUAL_INT16(2050, mapMeanCc(maps, 0));     // (2000 + 2101) / 2
+  TEST_ASSERT_EQUAL(-1, maps.sumCc[1]);                 // -0.4 -> 0, -0.6 -> -1
+  TEST_ASSERT_EQUAL(2, maps.count[1]);
+  TEST_ASSERT_EQUAL(0, maps.count[2]);
+  TEST_ASSERT_EQUAL_INT16(MAP_NO_DATA, mapMeanCc(maps, 2));
+  TEST_ASSERT_EQUAL_INT16(MAP_NO_DATA, maps.maxCc[2]);
+}
+
+void test_reset_starts_a_new_session() {
+  const float hot = 60.0f;
+  frame(1000, &hot, 1);
+  frame(2000, &hot, 1);
+  TEST_ASSERT_EQUAL(1000, maps.aboveMs[0]);
+
+  mapReset(maps, 5000);
+  TEST_ASSERT_EQUAL(0, maps.frames);
+  TEST_ASSERT_EQUAL_INT16(MAP_NO_DATA, maps.maxCc[0]);
+  TEST_ASSERT_EQUAL(0, maps.count[0]);
+  TEST_ASSERT_EQUAL(0, maps.aboveMs[0]);
+  TEST_ASSERT_EQUAL_INT16(MAP_NO_DATA, mapMeanCc(maps, 0));
+
+  // The gap before the reset is not counted, times restart at zero
+  const float warm = 50.0f;
+  frame(8000, &warm, 1);
+  frame(8100, &warm, 1);
+  TEST_ASSERT_EQUAL(100, maps.aboveMs[0]);
+  TEST_ASSERT_EQUAL(3000, maps.maxAtMs[0]);
+  TEST_ASSERT_EQUAL_INT16(5000, maps.maxCc[0]);
+}
+
+// mlxRead()'s loop over a full frame, with and without the map update
+static float frameBuf[PIXELS];
+
+static double loopNs(bool withMaps, int frames) {
+  volatile float sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int f = 0; f < frames; f++) {
+    float mx = -40, mn = 300, sum = 0;
+    int valid = 0;
+    if (withMaps) mapBeginFrame(maps, 1000 + f * 16);
+    for (int i = 0; i < PIXELS; i++) {
+      float t = frameBuf[i];
+      if (t > -20 && t < 200) {
+        if (t > mx) mx = t;
+        if (t < mn) mn = t;
+        sum += t;
+        valid++;
+        if (withMaps) mapAccumulate(maps, i, t);
+      }
+    }
+    sink = sink + mx + mn + sum / valid;
+    frameBuf[f % PIXELS] += 0.01f;   // keep the compiler from hoisting the frame
+  }
+  return std::chrono::duration<double, std::nano>(
+    std::chrono::steady_clock::now() - t0).count() / frames;
+}
+
+void test_frame_update_timing() {
+  for (int i = 0; i < PIXELS; i++) frameBuf[i] = 20.0f + (i % 37) * 0.9f;
+  const int frames = 20000;
+  double base = loopNs(false, frames);
+  double with = loopNs(true, frames);
+  TEST_ASSERT_EQUAL(frames, maps.frames);
+  TEST_ASSERT_EQUAL(frames, maps.count[0]);
+
+  char msg[128];
+  snprintf(msg, sizeof(msg), "768-pixel frame: %.2f us stats only, %.2f us with maps (+%.2f ns/pixel)",
+    base / 1000, with / 1000, (with - base) / PIXELS);
+  TEST_MESSAGE(msg);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_arena_holds_all_arrays);
+  RUN_TEST(test_old_16k_arena_is_too_small);
+  RUN_TEST(test_odd_pixel_counts_fit);
+  RUN_TEST(test_max_hold_keeps_first_time_of_max);
+  RUN_TEST(test_time_above_sums_frame_intervals);
+  RUN_TEST(test_threshold_is_configurable);
+  RUN_TEST(test_mean_and_rounding);
+  RUN_TEST(test_reset_starts_a_new_session);
+  RUN_TEST(test_frame_update_timing);
+  return UNITY_END();
+}